@@ -0,0 +1,114 @@
+# Generates ElementTable.hpp from the sorted element data in dat/
+# Usage: cmake -DDAT_DIR=<dat> -DOUTPUT=<ElementTable.hpp> -P ElementTable.cmake
+#
+# One entry per element of element_colors_sorted.dat, names and radii are looked
+# up by atomic number. Lines are "<atomic number> <value> [<value> ...]".
+
+if(NOT DAT_DIR OR NOT OUTPUT)
+    message(FATAL_ERROR "ElementTable.cmake needs -DDAT_DIR and -DOUTPUT")
+endif()
+
+# Reads a sorted dat file into VAR_<number> variables holding the values as a list
+function(read_element_dat file prefix)
+    file(STRINGS "${DAT_DIR}/${file}" lines)
+    foreach(line IN LISTS lines)
+        string(STRIP "${line}" line)
+        if(line STREQUAL "")
+            continue()
+        endif()
+        separate_arguments(fields UNIX_COMMAND "${line}")
+        list(GET fields 0 number)
+        list(REMOVE_AT fields 0)
+        set(${prefix}_${number} "${fields}" PARENT_SCOPE)
+    endforeach()
+endfunction()
+
+read_element_dat(element_names_sorted.dat NAME)
+read_element_dat(element_colors_sorted.dat COLOR)
+read_element_dat(element_vdw_radii_sorted.dat VDWR)
+read_element_dat(element_covalent_radii_sorted.dat COVR)
+
+set(LETTERS a b c d e f g h i j k l m n o p q r s t u v w x y z)
+
+# Symbol index by lowercase first letter and lowercase second letter (0 if none)
+set(symbol_index "")
+foreach(i RANGE 701)
+    list(APPEND symbol_index -1)
+endforeach()
+
+set(entries "")
+set(number 1)
+while(DEFINED COLOR_${number})
+    foreach(table NAME VDWR COVR)
+        if(NOT DEFINED ${table}_${number})
+            message(FATAL_ERROR "Element ${number} has a color but no ${table} entry in ${DAT_DIR}")
+        endif()
+    endforeach()
+    set(symbol "${NAME_${number}}")
+    string(LENGTH "${symbol}" length)
+    if(length LESS 1 OR length GREATER 2)
+        message(FATAL_ERROR "Element ${number} symbol \"${symbol}\" is not one or two letters")
+    endif()
+    string(TOLOWER "${symbol}" lower)
+    string(SUBSTRING "${lower}" 0 1 first)
+    list(FIND LETTERS "${first}" row)
+    set(column 0)
+    if(length EQUAL 2)
+        string(SUBSTRING "${lower}" 1 1 second)
+        list(FIND LETTERS "${second}" column)
+        math(EXPR column "${column} + 1")
+    endif()
+    math(EXPR slot "${row} * 27 + ${column}")
+    math(EXPR id "${number} - 1")
+    list(REMOVE_AT symbol_index ${slot})
+    list(INSERT symbol_index ${slot} ${id})
+
+    list(GET COLOR_${number} 0 r)
+    list(GET COLOR_${number} 1 g)
+    list(GET COLOR_${number} 2 b)
+    string(APPEND entries "        {\"${symbol}\", {${r}f, ${g}f, ${b}f}, ${VDWR_${number}}, ${COVR_${number}}},  // ${number}\n")
+    math(EXPR number "${number} + 1")
+endwhile()
+math(EXPR element_count "${number} - 1")
+
+set(index_rows "")
+foreach(row RANGE 25)
+    math(EXPR first "${row} * 27")
+    math(EXPR last "${first} + 26")
+    set(values "")
+    foreach(slot RANGE ${first} ${last})
+        list(GET symbol_index ${slot} value)
+        list(APPEND values ${value})
+    endforeach()
+    list(GET LETTERS ${row} letter)
+    string(REPLACE ";" ", " values "${values}")
+    string(APPEND index_rows "        {${values}},  // ${letter}\n")
+endforeach()
+
+set(content "// Generated from dat/*.dat by cmake/ElementTable.cmake, do not edit.
+#pragma once
+
+namespace chem {
+    const int ELEMENT_COUNT = ${element_count};
+
+    struct Element {
+        char symbol[3];
+        float color[3];
+        double vdwRadius;
+        double covalentRadius;
+    };
+
+    // Indexed by atomic number - 1
+    constexpr Element ELEMENT_TABLE[ELEMENT_COUNT] = {
+${entries}    };
+
+    // Element index by lowercase first letter and lowercase second letter + 1 (0 if none), -1 if unknown
+    constexpr signed char SYMBOL_INDEX[26][27] = {
+${index_rows}    };
+}
+")
+
+# Only touch the header when it changes, so sources are not rebuilt needlessly
+file(WRITE "${OUTPUT}.tmp" "${content}")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different "${OUTPUT}.tmp" "${OUTPUT}")
+file(REMOVE "${OUTPUT}.tmp")
@@ -0,0 +1,842 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <list>
+#include <deque>
+#include <memory>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <zlib.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+
+// Image formats
+extern const unsigned int IMAGE_FORMAT_PNG = 0;     // Deflate-compressed, smallest files
+extern const unsigned int IMAGE_FORMAT_PPM = 1;     // Binary portable pixmap (P6), uncompressed RGB
+extern const unsigned int IMAGE_FORMAT_PAM = 2;     // Portable arbitrary map (P7), uncompressed RGB
+extern const unsigned int IMAGE_FORMAT_QOI = 3;     // Quite OK Image, lossless and much faster than deflate
+extern const unsigned int IMAGE_FORMAT_RGBA = 4;    // Raw RGBA rows without a header, e.g. for ffmpeg -f rawvideo
+
+
+namespace exporter{
+    /*
+    One framebuffer on its way to a PNG file.
+    The GL thread reads it into a pixel buffer object and maps it once the
+    fence has passed; the worker copies the mapped pixels and releases them.
+    */
+    struct Readback {
+        unsigned int PBO;
+        GLsync fence;
+        int width;
+        int height;
+        std::string filename;
+        unsigned int format;
+        const unsigned char* mapped;    // RGBA rows, bottom row first, while mapped
+        bool released;                  // Worker is done with the mapped pixels, guarded by the mutex
+
+        Readback() : PBO(0), fence(0), width(0), height(0), format(IMAGE_FORMAT_PNG), mapped(NULL), released(false) {}
+    };
+
+    /*
+    Saves framebuffers as images without stalling the render loop.
+    glReadPixels goes into a pixel buffer object and returns at once, the
+    pixels are picked up by poll() in a later frame, then flipped and
+    encoded on a worker thread.
+    All methods except the worker itself run on the thread owning the GL context.
+    */
+    class AsyncExporter{
+        public:
+            AsyncExporter(int compressionLevel, int threadCount);
+            ~AsyncExporter();
+
+            void readFramebuffer(int width, int height, const std::string& filename, unsigned int format);
+            void poll(void);
+            void finish(void);
+            size_t pending(void) const;
+            size_t failures(void);
+        private:
+            std::list<std::shared_ptr<Readback>> readbacks;     // Owned by the GL thread
+            std::deque<std::shared_ptr<Readback>> jobs;         // Mapped readbacks for the worker
+            std::thread worker;
+            std::mutex mutex;
+            std::condition_variable wake;
+            bool stopping;
+            size_t failedCount;                                 // Images that could not be written, guarded by the mutex
+            int compressionLevel;
+            int threadCount;
+
+            void run(void);
+            void stopWorker(void);
+    };
+
+    /*
+    Rows of a PNG image filtered and compressed on their own.
+    The deflate data ends on a byte boundary without a final block,
+    so bands can be concatenated into one zlib stream.
+    */
+    struct DeflatedBand {
+        std::vector<unsigned char> data;
+        uLong adler;            // Adler-32 of the filtered rows
+        uLong filteredLength;   // Length of the filtered rows
+        bool ok;
+
+        DeflatedBand() : adler(0), filteredLength(0), ok(false) {}
+    };
+
+    /*
+    Running state of a QOI encoder, kept between bands of rows.
+    */
+    struct QOIEncoder {
+        unsigned char index[64][4];     // Recently seen pixels by hash
+        unsigned char previous[4];
+        int run;                        // Repeats of the previous pixel not yet written
+
+        QOIEncoder() : run(0) {
+            std::memset(index, 0, sizeof(index));
+            previous[0] = previous[1] = previous[2] = 0;
+            previous[3] = 255;
+        }
+    };
+
+    /*
+    Image file written band by band, so images larger than memory can be saved.
+    For PNG, each call to writeRows splits its rows into bands that are filtered and
+    deflated on several threads, then joined into one valid zlib stream.
+    The other formats are written as the rows arrive, without compression or
+    with QOI's single pass. The file name "-" writes to standard output.
+    */
+    class ImageStreamWriter{
+        public:
+            ImageStreamWriter();
+            ~ImageStreamWriter();
+
+            bool open(
+                const std::string& filename, unsigned int format, int width, int height,
+                int compressionLevel, int threadCount
+            );
+            bool writeRows(const unsigned char* rgb, int rowCount);
+            bool close(void);
+        private:
+            FILE* file;
+            bool ownsFile;                              // false for standard output
+            unsigned int format;
+            int width;
+            int height;
+            int rowsWritten;
+            int compressionLevel;
+            int threadCount;
+            uLong adler;                                // PNG: Adler-32 of all filtered rows so far
+            std::vector<unsigned char> previousRow;     // PNG: last row written, zero before the first row
+            QOIEncoder qoi;
+            std::vector<unsigned char> encoded;         // Rows converted for the output, reused between calls
+
+            bool writePNGHeader(void);
+            bool writePNGRows(const unsigned char* rgb, int rowCount);
+            bool writeChunk(const char* type, const unsigned char* data, size_t length);
+            bool writeBytes(const void* data, size_t length);
+            void abort(void);
+    };
+
+    void flipToRGB(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& rgb);
+    void filterRow(int filter, const unsigned char* row, const unsigned char* previousRow, size_t length, unsigned char* out);
+    void deflateBand(
+        const unsigned char* rgb, const unsigned char* previousRow, int rowCount, size_t rowLength,
+        int compressionLevel, DeflatedBand& band
+    );
+    int resolveThreadCount(int threadCount);
+    void encodeQOIPixels(const unsigned char* rgb, size_t pixelCount, QOIEncoder& state, std::vector<unsigned char>& out);
+    bool parseImageFormat(const std::string& name, unsigned int& format);
+    unsigned int formatFromFilename(const std::string& filename);
+    const char* formatExtension(unsigned int format);
+}
+
+
+/*
+Flip bottom-up RGBA rows into top-down RGB rows.
+@param rgba: Pixels as read from OpenGL.
+@param width: Image width.
+@param height: Image height.
+@param rgb: Receives the flipped pixels.
+*/
+void exporter::flipToRGB(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& rgb)
+{
+    rgb.resize((size_t)width * height * 3);
+    for (int y = 0; y < height; y++) {
+        const unsigned char* src = rgba + (size_t)(height - 1 - y) * width * 4;
+        unsigned char* dst = &rgb[(size_t)y * width * 3];
+        for (int x = 0; x < width; x++) {
+            dst[x * 3] = src[x * 4];
+            dst[x * 3 + 1] = src[x * 4 + 1];
+            dst[x * 3 + 2] = src[x * 4 + 2];
+        }
+    }
+}
+
+/*
+Apply one PNG filter to a row of RGB pixels.
+@param filter: PNG filter type, 0 (none) to 4 (Paeth).
+@param row: Row to filter.
+@param previousRow: Row above, all zeros for the first row.
+@param length: Row length in bytes.
+@param out: Receives the filtered bytes.
+*/
+void exporter::filterRow(int filter, const unsigned char* row, const unsigned char* previousRow, size_t length, unsigned char* out)
+{
+    const size_t bpp = 3;
+    for (size_t i = 0; i < length; i++) {
+        const int left = i >= bpp ? row[i - bpp] : 0;
+        const int up = previousRow[i];
+        const int upLeft = i >= bpp ? previousRow[i - bpp] : 0;
+        int predictor = 0;
+        if (filter == 1) {
+            predictor = left;
+        } else if (filter == 2) {
+            predictor = up;
+        } else if (filter == 3) {
+            predictor = (left + up) / 2;
+        } else if (filter == 4) {
+            const int p = left + up - upLeft;
+            const int pa = std::abs(p - left);
+            const int pb = std::abs(p - up);
+            const int pc = std::abs(p - upLeft);
+            predictor = (pa <= pb && pa <= pc) ? left : (pb <= pc ? up : upLeft);
+        }
+        out[i] = (unsigned char)(row[i] - predictor);
+    }
+}
+
+/*
+Filter and deflate a band of rows as raw deflate data.
+Filters are chosen per row with the minimum sum of absolute differences heuristic.
+The data is sync-flushed, not finished, so the next band can follow it directly.
+@param rgb: Top-down RGB rows of the band.
+@param previousRow: Row above the band, all zeros for the first row of the image.
+@param rowCount: Number of rows.
+@param rowLength: Row length in bytes.
+@param compressionLevel: zlib level, 0 to 9.
+@param band: Receives the compressed data and its checksum.
+*/
+void exporter::deflateBand(
+    const unsigned char* rgb, const unsigned char* previousRow, int rowCount, size_t rowLength,
+    int compressionLevel, DeflatedBand& band
+) {
+    std::vector<unsigned char> filtered((rowLength + 1) * rowCount);
+    std::vector<unsigned char> candidate(rowLength);
+    for (int r = 0; r < rowCount; r++) {
+        const unsigned char* row = rgb + r * rowLength;
+        const unsigned char* above = r == 0 ? previousRow : row - rowLength;
+        unsigned char* out = &filtered[r * (rowLength + 1)];
+        unsigned long bestScore = 0;
+        for (int filter = 0; filter <= 4; filter++) {
+            filterRow(filter, row, above, rowLength, candidate.data());
+            unsigned long score = 0;
+            for (size_t i = 0; i < rowLength; i++) {
+                score += std::abs((int)(signed char)candidate[i]);
+            }
+            if (filter == 0 || score < bestScore) {
+                bestScore = score;
+                out[0] = (unsigned char)filter;
+                std::memcpy(out + 1, candidate.data(), rowLength);
+            }
+        }
+    }
+    band.filteredLength = (uLong)filtered.size();
+    band.adler = adler32(adler32(0L, NULL, 0), filtered.data(), (uInt)filtered.size());
+
+    // Negative window bits: raw deflate, the zlib header and checksum are written once for the whole image
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, compressionLevel, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        band.ok = false;
+        return;
+    }
+    band.data.resize(deflateBound(&stream, (uLong)filtered.size()) + 16);
+    stream.next_in = filtered.data();
+    stream.avail_in = (uInt)filtered.size();
+    stream.next_out = band.data.data();
+    stream.avail_out = (uInt)band.data.size();
+    int status = deflate(&stream, Z_SYNC_FLUSH);
+    band.ok = (status == Z_OK || status == Z_BUF_ERROR) && stream.avail_in == 0;
+    band.data.resize(band.data.size() - stream.avail_out);
+    deflateEnd(&stream);
+}
+
+/*
+Number of encoder threads, 0 or less means one per hardware thread.
+*/
+int exporter::resolveThreadCount(int threadCount)
+{
+    if (threadCount > 0) {
+        return threadCount;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/*
+Append RGB pixels to a QOI stream. Runs still open at the end stay in the state,
+so an image can be encoded in several calls.
+@param rgb: Tightly packed RGB pixels.
+@param pixelCount: Number of pixels.
+@param state: Encoder state, carried over from the previous call.
+@param out: Receives the encoded bytes, appended.
+*/
+void exporter::encodeQOIPixels(const unsigned char* rgb, size_t pixelCount, QOIEncoder& state, std::vector<unsigned char>& out)
+{
+    for (size_t i = 0; i < pixelCount; i++) {
+        const unsigned char* px = rgb + i * 3;
+        if (px[0] == state.previous[0] && px[1] == state.previous[1] && px[2] == state.previous[2]) {
+            state.run++;
+            if (state.run == 62) {
+                out.push_back((unsigned char)(0xc0 | (state.run - 1)));
+                state.run = 0;
+            }
+            continue;
+        }
+        if (state.run > 0) {
+            out.push_back((unsigned char)(0xc0 | (state.run - 1)));
+            state.run = 0;
+        }
+
+        // Alpha is always 255, so only the color ops are needed
+        const int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + 255 * 11) % 64;
+        unsigned char* cached = state.index[hash];
+        if (cached[0] == px[0] && cached[1] == px[1] && cached[2] == px[2] && cached[3] == 255) {
+            out.push_back((unsigned char)hash);
+        } else {
+            cached[0] = px[0];
+            cached[1] = px[1];
+            cached[2] = px[2];
+            cached[3] = 255;
+            const signed char dr = (signed char)(px[0] - state.previous[0]);
+            const signed char dg = (signed char)(px[1] - state.previous[1]);
+            const signed char db = (signed char)(px[2] - state.previous[2]);
+            const int drg = dr - dg;
+            const int dbg = db - dg;
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                out.push_back((unsigned char)(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+            } else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+                out.push_back((unsigned char)(0x80 | (dg + 32)));
+                out.push_back((unsigned char)((drg + 8) << 4 | (dbg + 8)));
+            } else {
+                out.push_back(0xfe);
+                out.push_back(px[0]);
+                out.push_back(px[1]);
+                out.push_back(px[2]);
+            }
+        }
+        state.previous[0] = px[0];
+        state.previous[1] = px[1];
+        state.previous[2] = px[2];
+    }
+}
+
+/*
+Look up an image format by name: png, ppm, pam, qoi or rgba, in any case.
+@param name: Format name or file extension without the dot.
+@param format: Receives the format.
+@return: false if the name is not a known format.
+*/
+bool exporter::parseImageFormat(const std::string& name, unsigned int& format)
+{
+    std::string lower = name;
+    for (size_t i = 0; i < lower.size(); i++) {
+        lower[i] = (char)std::tolower((unsigned char)lower[i]);
+    }
+    if (lower == "png") {
+        format = IMAGE_FORMAT_PNG;
+    } else if (lower == "ppm") {
+        format = IMAGE_FORMAT_PPM;
+    } else if (lower == "pam") {
+        format = IMAGE_FORMAT_PAM;
+    } else if (lower == "qoi") {
+        format = IMAGE_FORMAT_QOI;
+    } else if (lower == "rgba" || lower == "raw") {
+        format = IMAGE_FORMAT_RGBA;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/*
+Image format from the extension of a file name, PNG when it has no known extension.
+*/
+unsigned int exporter::formatFromFilename(const std::string& filename)
+{
+    unsigned int format = IMAGE_FORMAT_PNG;
+    size_t dot = filename.find_last_of('.');
+    size_t slash = filename.find_last_of("/\\");
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        parseImageFormat(filename.substr(dot + 1), format);
+    }
+    return format;
+}
+
+const char* exporter::formatExtension(unsigned int format)
+{
+    if (format == IMAGE_FORMAT_PPM) {
+        return ".ppm";
+    } else if (format == IMAGE_FORMAT_PAM) {
+        return ".pam";
+    } else if (format == IMAGE_FORMAT_QOI) {
+        return ".qoi";
+    } else if (format == IMAGE_FORMAT_RGBA) {
+        return ".rgba";
+    }
+    return ".png";
+}
+
+exporter::ImageStreamWriter::ImageStreamWriter() : file(NULL), ownsFile(false), format(IMAGE_FORMAT_PNG),
+    width(0), height(0), rowsWritten(0), compressionLevel(Z_DEFAULT_COMPRESSION), threadCount(1), adler(1) {}
+
+exporter::ImageStreamWriter::~ImageStreamWriter()
+{
+    this->abort();
+}
+
+/*
+Create the file and write the image header.
+@param filename: Output file name, "-" for standard output. Named pipes work like files.
+@param format: Image format, IMAGE_FORMAT_PNG, _PPM, _PAM, _QOI or _RGBA.
+@param width: Image width.
+@param height: Image height.
+@param compressionLevel: PNG only, zlib level, 0 (store) to 9 (smallest).
+@param threadCount: PNG only, encoder threads, 0 for one per hardware thread.
+@return: false if the file could not be created.
+*/
+bool exporter::ImageStreamWriter::open(
+    const std::string& filename, unsigned int format, int width, int height,
+    int compressionLevel, int threadCount
+) {
+    this->abort();
+    if (filename == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        this->file = stdout;
+        this->ownsFile = false;
+    } else {
+        this->file = std::fopen(filename.c_str(), "wb");
+        this->ownsFile = true;
+    }
+    if (this->file == NULL) {
+        return false;
+    }
+    this->format = format;
+    this->width = width;
+    this->height = height;
+    this->rowsWritten = 0;
+
+    bool written = true;
+    if (format == IMAGE_FORMAT_PNG) {
+        this->compressionLevel = std::min(std::max(compressionLevel, 0), 9);
+        this->threadCount = resolveThreadCount(threadCount);
+        written = this->writePNGHeader();
+    } else if (format == IMAGE_FORMAT_PPM || format == IMAGE_FORMAT_PAM) {
+        char header[128];
+        if (format == IMAGE_FORMAT_PPM) {
+            std::snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+        } else {
+            std::snprintf(header, sizeof(header),
+                "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 3\nMAXVAL 255\nTUPLTYPE RGB\nENDHDR\n", width, height);
+        }
+        written = this->writeBytes(header, std::strlen(header));
+    } else if (format == IMAGE_FORMAT_QOI) {
+        this->qoi = QOIEncoder();
+        const unsigned char header[14] = {
+            'q', 'o', 'i', 'f',
+            (unsigned char)(width >> 24), (unsigned char)(width >> 16), (unsigned char)(width >> 8), (unsigned char)width,
+            (unsigned char)(height >> 24), (unsigned char)(height >> 16), (unsigned char)(height >> 8), (unsigned char)height,
+            3, 0    // RGB, sRGB with linear alpha
+        };
+        written = this->writeBytes(header, 14);
+    }
+    if (!written) {
+        this->abort();
+        return false;
+    }
+    return true;
+}
+
+/*
+Append rows to the image.
+@param rgb: Top-down RGB rows, tightly packed.
+@param rowCount: Number of rows.
+@return: false if compressing or writing failed.
+*/
+bool exporter::ImageStreamWriter::writeRows(const unsigned char* rgb, int rowCount)
+{
+    if (this->file == NULL) {
+        return false;
+    }
+    rowCount = std::min(rowCount, this->height - this->rowsWritten);
+    if (rowCount <= 0) {
+        return true;
+    }
+    const size_t pixelCount = (size_t)this->width * rowCount;
+    bool written = true;
+    if (this->format == IMAGE_FORMAT_PNG) {
+        written = this->writePNGRows(rgb, rowCount);
+    } else if (this->format == IMAGE_FORMAT_QOI) {
+        this->encoded.clear();
+        encodeQOIPixels(rgb, pixelCount, this->qoi, this->encoded);
+        written = this->writeBytes(this->encoded.data(), this->encoded.size());
+    } else if (this->format == IMAGE_FORMAT_RGBA) {
+        // Rendered images are opaque
+        this->encoded.resize(pixelCount * 4);
+        for (size_t i = 0; i < pixelCount; i++) {
+            this->encoded[i * 4] = rgb[i * 3];
+            this->encoded[i * 4 + 1] = rgb[i * 3 + 1];
+            this->encoded[i * 4 + 2] = rgb[i * 3 + 2];
+            this->encoded[i * 4 + 3] = 255;
+        }
+        written = this->writeBytes(this->encoded.data(), this->encoded.size());
+    } else {
+        // PPM and PAM store the rows as they are
+        written = this->writeBytes(rgb, pixelCount * 3);
+    }
+    if (!written) {
+        this->abort();
+        return false;
+    }
+    this->rowsWritten += rowCount;
+    return true;
+}
+
+/*
+Finish the image and close the file.
+@return: false if rows are missing or writing failed.
+*/
+bool exporter::ImageStreamWriter::close(void)
+{
+    if (this->file == NULL) {
+        return false;
+    }
+    bool complete = this->rowsWritten == this->height;
+    if (complete && this->format == IMAGE_FORMAT_PNG) {
+        // Empty final block with fixed codes, then the checksum of all rows
+        const unsigned char trailer[6] = {
+            0x03, 0x00,
+            (unsigned char)(this->adler >> 24), (unsigned char)(this->adler >> 16),
+            (unsigned char)(this->adler >> 8), (unsigned char)this->adler
+        };
+        complete = this->writeChunk("IDAT", trailer, 6)
+            && this->writeChunk("IEND", NULL, 0);
+    } else if (complete && this->format == IMAGE_FORMAT_QOI) {
+        const unsigned char run = (unsigned char)(0xc0 | (this->qoi.run - 1));
+        const unsigned char padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+        complete = (this->qoi.run == 0 || this->writeBytes(&run, 1))
+            && this->writeBytes(padding, 8);
+    }
+    if (this->ownsFile) {
+        complete = (std::fclose(this->file) == 0) && complete;
+    } else {
+        complete = (std::fflush(this->file) == 0) && complete;
+    }
+    this->file = NULL;
+    return complete;
+}
+
+/*
+Write the PNG signature, the image header and the zlib header.
+*/
+bool exporter::ImageStreamWriter::writePNGHeader(void)
+{
+    this->adler = adler32(0L, NULL, 0);
+    this->previousRow.assign((size_t)this->width * 3, 0);
+
+    static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    unsigned char header[13] = {
+        (unsigned char)(this->width >> 24), (unsigned char)(this->width >> 16),
+        (unsigned char)(this->width >> 8), (unsigned char)this->width,
+        (unsigned char)(this->height >> 24), (unsigned char)(this->height >> 16),
+        (unsigned char)(this->height >> 8), (unsigned char)this->height,
+        8, 2, 0, 0, 0   // 8 bit RGB, deflate, adaptive filtering, no interlace
+    };
+    // zlib header: deflate with a 32K window, level hint, check bits
+    const unsigned char levelHint = this->compressionLevel < 2 ? 0 : (this->compressionLevel < 6 ? 1 : (this->compressionLevel == 6 ? 2 : 3));
+    unsigned char zlibHeader[2] = {0x78, (unsigned char)(levelHint << 6)};
+    zlibHeader[1] += 31 - (zlibHeader[0] * 256 + zlibHeader[1]) % 31;
+    return this->writeBytes(signature, 8)
+        && this->writeChunk("IHDR", header, 13)
+        && this->writeChunk("IDAT", zlibHeader, 2);
+}
+
+/*
+Compress rows into PNG data. The rows are split evenly into one band per thread,
+each band at least 32 rows so back-references across rows are not lost.
+*/
+bool exporter::ImageStreamWriter::writePNGRows(const unsigned char* rgb, int rowCount)
+{
+    const size_t rowLength = (size_t)this->width * 3;
+    const int minBandRows = 32;
+    const int bandCount = std::max(1, std::min(this->threadCount, rowCount / minBandRows));
+
+    std::vector<DeflatedBand> bands(bandCount);
+    std::vector<std::thread> workers;
+    for (int b = 0; b < bandCount; b++) {
+        // Proportional split, band sizes differ by at most one row and none is empty
+        const int firstRow = (int)((long long)rowCount * b / bandCount);
+        const int bandRows = (int)((long long)rowCount * (b + 1) / bandCount) - firstRow;
+        assert(bandRows > 0);
+        const unsigned char* bandRGB = rgb + firstRow * rowLength;
+        const unsigned char* above = b == 0 ? this->previousRow.data() : bandRGB - rowLength;
+        if (b == bandCount - 1) {
+            // The calling thread takes the last band
+            deflateBand(bandRGB, above, bandRows, rowLength, this->compressionLevel, bands[b]);
+        } else {
+            workers.push_back(std::thread(
+                deflateBand, bandRGB, above, bandRows, rowLength, this->compressionLevel, std::ref(bands[b])
+            ));
+        }
+    }
+    for (size_t w = 0; w < workers.size(); w++) {
+        workers[w].join();
+    }
+
+    for (int b = 0; b < bandCount; b++) {
+        if (!bands[b].ok || !this->writeChunk("IDAT", bands[b].data.data(), bands[b].data.size())) {
+            return false;
+        }
+        this->adler = adler32_combine(this->adler, bands[b].adler, bands[b].filteredLength);
+    }
+    std::memcpy(this->previousRow.data(), rgb + (rowCount - 1) * rowLength, rowLength);
+    return true;
+}
+
+bool exporter::ImageStreamWriter::writeChunk(const char* type, const unsigned char* data, size_t length)
+{
+    unsigned char lengthBytes[4] = {
+        (unsigned char)(length >> 24), (unsigned char)(length >> 16), (unsigned char)(length >> 8), (unsigned char)length
+    };
+    uLong crc = crc32(0L, (const Bytef*)type, 4);
+    if (length > 0) {
+        crc = crc32(crc, data, (uInt)length);
+    }
+    unsigned char crcBytes[4] = {
+        (unsigned char)(crc >> 24), (unsigned char)(crc >> 16), (unsigned char)(crc >> 8), (unsigned char)crc
+    };
+    return this->writeBytes(lengthBytes, 4)
+        && this->writeBytes(type, 4)
+        && this->writeBytes(data, length)
+        && this->writeBytes(crcBytes, 4);
+}
+
+bool exporter::ImageStreamWriter::writeBytes(const void* data, size_t length)
+{
+    return length == 0 || std::fwrite(data, 1, length, this->file) == length;
+}
+
+void exporter::ImageStreamWriter::abort(void)
+{
+    if (this->file != NULL) {
+        if (this->ownsFile) {
+            std::fclose(this->file);
+        } else {
+            std::fflush(this->file);
+        }
+        this->file = NULL;
+    }
+}
+
+/*
+@param compressionLevel: zlib level of written PNG files, 0 to 9.
+@param threadCount: PNG encoder threads, 0 for one per hardware thread.
+*/
+exporter::AsyncExporter::AsyncExporter(int compressionLevel, int threadCount) :
+    stopping(false), failedCount(0), compressionLevel(compressionLevel), threadCount(threadCount) {}
+
+exporter::AsyncExporter::~AsyncExporter()
+{
+    // GL objects are released by finish(), here only the worker is stopped
+    this->stopWorker();
+}
+
+/*
+Start reading the bound framebuffer. Returns without waiting for the GPU.
+@param width: Framebuffer width.
+@param height: Framebuffer height.
+@param filename: Image file to write once the pixels arrive.
+@param format: Image format, IMAGE_FORMAT_PNG, _PPM, _PAM, _QOI or _RGBA.
+*/
+void exporter::AsyncExporter::readFramebuffer(int width, int height, const std::string& filename, unsigned int format)
+{
+    std::shared_ptr<Readback> readback(new Readback());
+    readback->width = width;
+    readback->height = height;
+    readback->filename = filename;
+    readback->format = format;
+
+    // RGBA matches the framebuffer layout, so the copy stays on the GPU's fast path
+    glGenBuffers(1, &readback->PBO);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->PBO);
+    glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    readback->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    this->readbacks.push_back(readback);
+
+    if (!this->worker.joinable()) {
+        this->stopping = false;
+        this->worker = std::thread(&AsyncExporter::run, this);
+    }
+}
+
+/*
+Hand finished readbacks to the worker and free the ones it has copied.
+Readbacks go to the worker in request order, so a sequence written to one
+stream stays in order. Called once per frame, never blocks.
+*/
+void exporter::AsyncExporter::poll(void)
+{
+    std::list<std::shared_ptr<Readback>>::iterator it = this->readbacks.begin();
+    while (it != this->readbacks.end()) {
+        Readback& readback = **it;
+        if (readback.fence != 0) {
+            GLenum status = glClientWaitSync(readback.fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                // Fences pass in order, the readbacks after this one are not ready either
+                break;
+            }
+            glDeleteSync(readback.fence);
+            readback.fence = 0;
+
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.PBO);
+            readback.mapped = (const unsigned char*)glMapBufferRange(
+                GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)readback.width * readback.height * 4, GL_MAP_READ_BIT
+            );
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            if (readback.mapped == NULL) {
+                std::cout << "Failed to map pixels for " << readback.filename << std::endl;
+                glDeleteBuffers(1, &readback.PBO);
+                it = this->readbacks.erase(it);
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->jobs.push_back(*it);
+            this->wake.notify_one();
+        }
+
+        bool released;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            released = readback.released;
+        }
+        if (released) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.PBO);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            glDeleteBuffers(1, &readback.PBO);
+            it = this->readbacks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/*
+Wait until every requested image is written. Call before the GL context goes away.
+*/
+void exporter::AsyncExporter::finish(void)
+{
+    while (!this->readbacks.empty()) {
+        this->poll();
+        if (!this->readbacks.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    this->stopWorker();
+}
+
+/*
+Number of readbacks not yet copied by the worker.
+*/
+size_t exporter::AsyncExporter::pending(void) const
+{
+    return this->readbacks.size();
+}
+
+/*
+Number of images the worker failed to write so far.
+*/
+size_t exporter::AsyncExporter::failures(void)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->failedCount;
+}
+
+void exporter::AsyncExporter::stopWorker(void)
+{
+    if (!this->worker.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_one();
+    this->worker.join();
+}
+
+/*
+Worker loop: copy the mapped pixels out, release them, then encode.
+Remaining jobs are written before the worker stops.
+*/
+void exporter::AsyncExporter::run(void)
+{
+    std::vector<unsigned char> rgb;
+    while (true) {
+        std::shared_ptr<Readback> readback;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            while (this->jobs.empty() && !this->stopping) {
+                this->wake.wait(lock);
+            }
+            if (this->jobs.empty()) {
+                return;
+            }
+            readback = this->jobs.front();
+            this->jobs.pop_front();
+        }
+
+        flipToRGB(readback->mapped, readback->width, readback->height, rgb);
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            readback->mapped = NULL;
+            readback->released = true;
+        }
+
+        ImageStreamWriter image;
+        if (image.open(readback->filename, readback->format, readback->width, readback->height,
+                this->compressionLevel, this->threadCount)
+            && image.writeRows(rgb.data(), readback->height)
+            && image.close()) {
+            std::cout << "Image exported successfully: " << readback->filename
+                      << " (" << readback->width << "x" << readback->height << ")" << std::endl;
+        } else {
+            std::cout << "Failed to export image " << readback->filename << std::endl;
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->failedCount++;
+        }
+    }
+}
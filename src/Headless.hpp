@@ -0,0 +1,149 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+#ifdef HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+
+namespace headless{
+    /*
+    OpenGL context without a window, rendering goes to framebuffer objects.
+    */
+    struct Context {
+#ifdef HEADLESS_EGL
+        EGLDisplay display;
+        EGLContext context;
+
+        Context() : display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT) {}
+#endif
+    };
+
+    bool createContext(Context& context);
+    void destroyContext(Context& context);
+    bool parseSize(const std::string& text, int& width, int& height);
+}
+
+
+/*
+Create a surfaceless OpenGL 3.3 core context and make it current.
+Uses the Mesa surfaceless platform when available, so no display or GPU is
+required (llvmpipe renders on the CPU).
+@param context: Context to fill.
+@return: false if no context could be created.
+*/
+bool headless::createContext(Context& context)
+{
+#ifdef HEADLESS_EGL
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay != NULL) {
+        context.display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (context.display == EGL_NO_DISPLAY) {
+        context.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint major, minor;
+    if (context.display == EGL_NO_DISPLAY || !eglInitialize(context.display, &major, &minor)) {
+        std::cout << "Failed to initialize EGL display" << std::endl;
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cout << "EGL does not support desktop OpenGL" << std::endl;
+        eglTerminate(context.display);
+        return false;
+    }
+
+    // Surfaceless displays only offer pbuffer configs, the default asks for windows
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(context.display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        std::cout << "Failed to choose EGL config" << std::endl;
+        eglTerminate(context.display);
+        return false;
+    }
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    context.context = eglCreateContext(context.display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context.context == EGL_NO_CONTEXT) {
+        std::cout << "Failed to create EGL context" << std::endl;
+        eglTerminate(context.display);
+        return false;
+    }
+
+    // No surface: everything is drawn into framebuffer objects
+    if (!eglMakeCurrent(context.display, EGL_NO_SURFACE, EGL_NO_SURFACE, context.context)) {
+        std::cout << "Failed to make EGL context current" << std::endl;
+        destroyContext(context);
+        return false;
+    }
+    return true;
+#else
+    std::cout << "Headless rendering is not available: built without EGL" << std::endl;
+    return false;
+#endif
+}
+
+void headless::destroyContext(Context& context)
+{
+#ifdef HEADLESS_EGL
+    if (context.display != EGL_NO_DISPLAY) {
+        eglMakeCurrent(context.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context.context != EGL_NO_CONTEXT) {
+            eglDestroyContext(context.display, context.context);
+        }
+        eglTerminate(context.display);
+    }
+    context = Context();
+#endif
+}
+
+/*
+Parse an image size of the form WxH.
+@param text: Size text, e.g. 1920x1080.
+@param width: Parsed width.
+@param height: Parsed height.
+@return: false if the text is not a valid size.
+*/
+bool headless::parseSize(const std::string& text, int& width, int& height)
+{
+    size_t separator = text.find_first_of("xX");
+    if (separator == std::string::npos) {
+        return false;
+    }
+    char* end = NULL;
+    std::string widthText = text.substr(0, separator);
+    std::string heightText = text.substr(separator + 1);
+    long w = std::strtol(widthText.c_str(), &end, 10);
+    if (widthText.empty() || *end != '\0') {
+        return false;
+    }
+    long h = std::strtol(heightText.c_str(), &end, 10);
+    if (heightText.empty() || *end != '\0') {
+        return false;
+    }
+    if (w <= 0 || h <= 0 || w > 32768 || h > 32768) {
+        return false;
+    }
+    width = (int)w;
+    height = (int)h;
+    return true;
+}
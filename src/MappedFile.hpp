@@ -0,0 +1,126 @@
+#pragma once
+
+#include<iostream>
+#include<string>
+#include<vector>
+#include<fstream>
+
+#ifndef _WIN32
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#endif
+
+
+namespace chem{
+    /*
+    Read-only view of a whole file.
+    The file is memory-mapped where mmap is available, so large files are
+    paged in on demand instead of being copied into the heap.
+    */
+    class MappedFile{
+        public:
+            MappedFile();
+            ~MappedFile();
+
+            bool open(const std::string& filename);
+            void close(void);
+            const char* begin(void) const;
+            const char* end(void) const;
+            size_t size(void) const;
+        private:
+            const char* data;
+            size_t length;
+#ifdef _WIN32
+            std::vector<char> buffer;
+#else
+            int fd;
+#endif
+            MappedFile(const MappedFile&);
+            MappedFile& operator=(const MappedFile&);
+    };
+}
+
+#ifdef _WIN32
+chem::MappedFile::MappedFile() : data(NULL), length(0) {}
+#else
+chem::MappedFile::MappedFile() : data(NULL), length(0), fd(-1) {}
+#endif
+
+chem::MappedFile::~MappedFile(){
+    this->close();
+}
+
+/*
+Map a file into memory.
+@param filename: File to open.
+@return: false if the file could not be opened or mapped.
+*/
+bool chem::MappedFile::open(const std::string& filename){
+    this->close();
+#ifdef _WIN32
+    std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
+    if (file.fail()){
+        return false;
+    }
+    this->buffer.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(this->buffer.data(), this->buffer.size());
+    this->data = this->buffer.data();
+    this->length = this->buffer.size();
+    return true;
+#else
+    this->fd = ::open(filename.c_str(), O_RDONLY);
+    if (this->fd < 0){
+        return false;
+    }
+    struct stat file_stat;
+    if (fstat(this->fd, &file_stat) != 0){
+        this->close();
+        return false;
+    }
+    this->length = static_cast<size_t>(file_stat.st_size);
+    if (this->length == 0){
+        // mmap rejects empty mappings, an empty view is still valid
+        return true;
+    }
+    void* mapped = mmap(NULL, this->length, PROT_READ, MAP_PRIVATE, this->fd, 0);
+    if (mapped == MAP_FAILED){
+        std::cout << filename << " could not be mapped" << std::endl;
+        this->close();
+        return false;
+    }
+    madvise(mapped, this->length, MADV_SEQUENTIAL);
+    this->data = static_cast<const char*>(mapped);
+    return true;
+#endif
+}
+
+void chem::MappedFile::close(void){
+#ifdef _WIN32
+    std::vector<char>().swap(this->buffer);
+#else
+    if (this->data != NULL){
+        munmap(const_cast<char*>(this->data), this->length);
+    }
+    if (this->fd >= 0){
+        ::close(this->fd);
+        this->fd = -1;
+    }
+#endif
+    this->data = NULL;
+    this->length = 0;
+}
+
+const char* chem::MappedFile::begin(void) const{
+    return this->data;
+}
+
+const char* chem::MappedFile::end(void) const{
+    return this->data + this->length;
+}
+
+size_t chem::MappedFile::size(void) const{
+    return this->length;
+}
@@ -7,21 +7,39 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <vector>
+#include <map>
+#include <utility>
 #include <cmath>
+#include <algorithm>
 
 #include "ShapeGenerator.hpp"
 #include "Molecule.hpp"
 #include "Element.hpp"
+#include "Shader.hpp"
 
 
 const float VDWR_SCALING_RATIO = 0.2f;
 const float BOND_RADIUS = 0.05f;
 const int ATOM_MODEL_RESOLUTION = 8;
 const int BOND_MODEL_RESOLUTION = 3;
+// Resolutions picked by the level of detail, few enough to keep the mesh cache small
+const int MESH_LOD_RESOLUTIONS[] = {3, 4, 6, 8, 12, 16, 24, 32};
+const int MESH_LOD_COUNT = sizeof(MESH_LOD_RESOLUTIONS) / sizeof(MESH_LOD_RESOLUTIONS[0]);
 
 
 extern const unsigned int MODEL_MODEL_CPK = 0;
 extern const unsigned int MODEL_MODEL_LINE = 1;
+extern const unsigned int MODEL_MODEL_IMPOSTOR = 2;  // Ray-cast spheres and cylinders on screen-aligned quads
+
+extern const unsigned int MODEL_TYPE_MESH = 0;       // Single mesh placed by its transform
+extern const unsigned int MODEL_TYPE_ATOMS = 1;      // Unit sphere instanced once per atom
+extern const unsigned int MODEL_TYPE_BONDS = 2;      // Unit cylinder instanced once per bond
+extern const unsigned int MODEL_TYPE_ATOM_IMPOSTORS = 3;  // Quad instanced once per atom, ray-cast sphere
+extern const unsigned int MODEL_TYPE_BOND_IMPOSTORS = 4;  // Quad instanced once per bond, ray-cast cylinder
+
+extern const unsigned int MESH_SHAPE_SPHERE = 0;     // Unit sphere
+extern const unsigned int MESH_SHAPE_CYLINDER = 1;   // Unit cylinder along z
+extern const unsigned int MESH_SHAPE_QUAD = 2;       // Impostor quad
 
 
 namespace model{
@@ -29,164 +47,421 @@ namespace model{
     struct Model {
         // Vertex Array Object
         unsigned int VAO;
-        // Vertex Buffer Object.
+        // Vertex Buffer Object, shared through the mesh cache
         unsigned int VBO;
+        // MESH_SHAPE_* and resolution of the mesh bound to the VAO
+        unsigned int meshShape;
+        int meshResolution;
+        // Largest radius of the instances, sets the level of detail
+        float instanceRadius;
+        // Per-instance attribute buffer, 0 for a plain mesh
+        unsigned int instanceVBO;
         // Vertex count
         int vertexCount;
+        // Index count, 0 for a mesh drawn without an index buffer
+        int indexCount;
+        // Instance count, 0 for a plain mesh
+        int instanceCount;
+        // MODEL_TYPE_*, selects the shaders used to draw the model
+        unsigned int type;
+        // Primitive passed to the draw call
+        GLenum primitive;
         // Transformation matrix
         glm::mat4 transform;
+        // Translations of the periodic images drawn, a single copy when empty
+        std::vector<glm::vec3> imageOffsets;
         glm::vec3 color;
         // float alpha;
 
-        Model() : VAO(0), VBO(0), vertexCount(0), 
+        Model() : VAO(0), VBO(0), meshShape(MESH_SHAPE_QUAD), meshResolution(0), instanceRadius(0.0f), instanceVBO(0), vertexCount(0), indexCount(0), instanceCount(0),
+                type(MODEL_TYPE_MESH), primitive(GL_TRIANGLES),
                 transform(glm::mat4(1.0f)), 
                 color(glm::vec3(0.3f, 0.8f, 0.3f)){}
     };
 
-    void renderModel(const Model& model, unsigned int shader, const glm::mat4& view, const glm::mat4& );
+    /*
+    Vertex and 16-bit index buffer of one shape at one resolution, shared by every model drawing it
+    */
+    struct MeshBuffer {
+        unsigned int VBO;
+        unsigned int EBO;       // 0 for a shape drawn without indices
+        int vertexCount;
+        int indexCount;
+
+        MeshBuffer() : VBO(0), EBO(0), vertexCount(0), indexCount(0) {}
+    };
+
+    /*
+    Look of one molecule layer
+    */
+    struct LayerStyle {
+        glm::vec3 color;        // Used when OVERWRITE_COLOR is set
+        float alpha;            // Transparency, 1.0f for fully opaque
+        unsigned int mode;      // MODEL_MODEL_CPK, MODEL_MODEL_LINE or MODEL_MODEL_IMPOSTOR
+    };
+
+    void drawModel(const Model& model);
+    void renderModel(const Model& model, const shader::Shader& shader);
     void cleanupModels(std::vector<Model>& models);
-    Model loadAtomModel(const unsigned int& atom_number, const std::array<double, 3>& atom_coord);
-    Model loadBondModel(const std::array<double, 6>& bond_vec);
+    std::map<std::pair<unsigned int, int>, MeshBuffer>& meshCache(void);
+    const MeshBuffer& sharedMesh(unsigned int shape, int resolution);
+    void cleanupMeshCache(void);
+    void loadMesh(Model& model, unsigned int shape, int resolution);
+    void bindMesh(Model& model, unsigned int shape, int resolution);
+    int levelOfDetail(float radiusPixels, float segmentPixels);
+    void setLevelOfDetail(Model& model, float pixelsPerUnit, float outlineSize, float segmentPixels);
+    void loadAtomInstances(Model& model, chem::MoleculeFile& moleculeFile);
+    void loadBondInstances(Model& model, chem::MoleculeFile& moleculeFile);
+    Model loadAtomModel(chem::MoleculeFile& moleculeFile);
+    Model loadBondModel(chem::MoleculeFile& moleculeFile);
+    Model loadAtomImpostorModel(chem::MoleculeFile& moleculeFile);
+    Model loadBondImpostorModel(chem::MoleculeFile& moleculeFile);
     std::vector<model::Model> loadMoleculeModel(chem::MoleculeFile& moleculeFile);
     std::vector<model::Model> loadMoleculeModel(chem::MoleculeFile& moleculeFile, const int& mode);
+    void setPeriodicImages(std::vector<Model>& models, const chem::MoleculeFile& moleculeFile, const std::array<int, 3>& cells);
 }
 
 
+/*
+Issue the draw call of a model with the currently bound shader.
+Instanced models are drawn in a single call for all instances.
+@param model: Model to draw.
+*/
+void model::drawModel(const Model& model) {
+    glBindVertexArray(model.VAO);
+    if (model.indexCount > 0 && model.instanceVBO != 0) {
+        glDrawElementsInstanced(model.primitive, model.indexCount, GL_UNSIGNED_SHORT, (void*)0, model.instanceCount);
+    } else if (model.indexCount > 0) {
+        glDrawElements(model.primitive, model.indexCount, GL_UNSIGNED_SHORT, (void*)0);
+    } else if (model.instanceVBO != 0) {
+        glDrawArraysInstanced(model.primitive, 0, model.vertexCount, model.instanceCount);
+    } else {
+        glDrawArrays(model.primitive, 0, model.vertexCount);
+    }
+}
+
 /*
 Render a model.
+View and projection come from the FrameData uniform buffer.
 @param model: Model to render.
-@param shader: Shader to use.
-@param view: View matrix.
-@param projection: Projection matrix.
+@param shader: Shader to use, already bound.
 */
 void model::renderModel(
     const Model& model,
-    unsigned int shader, 
-    const glm::mat4& view,
-    const glm::mat4& 
+    const shader::Shader& shader
 ) {
-    glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, glm::value_ptr(model.transform));
+    glUniformMatrix4fv(shader.modelLocation, 1, GL_FALSE, glm::value_ptr(model.transform));
     
     // Set object color if it's the toon shader
-    GLint colorLocation = glGetUniformLocation(shader, "objectColor");
-    if (colorLocation != -1) {
-        glUniform3fv(colorLocation, 1, glm::value_ptr(model.color));
+    if (shader.objectColorLocation != -1) {
+        glUniform3fv(shader.objectColorLocation, 1, glm::value_ptr(model.color));
     }
     
+    model::drawModel(model);
+}
+
+/*
+Meshes uploaded so far, keyed by shape and resolution.
+*/
+std::map<std::pair<unsigned int, int>, model::MeshBuffer>& model::meshCache(void) {
+    static std::map<std::pair<unsigned int, int>, MeshBuffer> cache;
+    return cache;
+}
+
+/*
+Vertex buffer of a shape, generated and uploaded on first use only.
+Atoms and bonds are instances of unit shapes, so one buffer per shape and
+resolution serves every element, layer and trajectory frame.
+Spheres and cylinders are indexed, each grid vertex is stored once.
+@param shape: MESH_SHAPE_SPHERE, MESH_SHAPE_CYLINDER or MESH_SHAPE_QUAD.
+@param resolution: Stacks of the sphere or cylinder, ignored for the quad.
+@return: Interleaved [x,y,z,nx,ny,nz] vertices on the GPU.
+*/
+const model::MeshBuffer& model::sharedMesh(unsigned int shape, int resolution) {
+    if (shape == MESH_SHAPE_QUAD) {
+        resolution = 0;
+    }
+    MeshBuffer& mesh = meshCache()[std::make_pair(shape, resolution)];
+    if (mesh.VBO != 0) {
+        return mesh;
+    }
+
+    std::vector<float> vertices;
+    std::vector<unsigned short> indices;
+    if (shape == MESH_SHAPE_SPHERE) {
+        SphereGenerator::generateIndexedVertices(1.0f, resolution*2, resolution, vertices, indices);
+    } else if (shape == MESH_SHAPE_CYLINDER) {
+        CylinderGenerator::generateIndexedVertices(1.0f, 1.0f, resolution*2, resolution, vertices, indices);
+    } else {
+        vertices = QuadGenerator::generateVertices();
+    }
+    glGenBuffers(1, &mesh.VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    mesh.vertexCount = vertices.size() / 6;
+
+    if (!indices.empty()) {
+        // Bound to a VAO by loadMesh only, binding it here would change the current VAO
+        glGenBuffers(1, &mesh.EBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, mesh.EBO);
+        glBufferData(GL_COPY_WRITE_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        mesh.indexCount = indices.size();
+    }
+    return mesh;
+}
+
+/*
+Delete the shared meshes, after every model using them is cleaned up.
+*/
+void model::cleanupMeshCache(void) {
+    std::map<std::pair<unsigned int, int>, MeshBuffer>& cache = meshCache();
+    for (auto& entry : cache) {
+        glDeleteBuffers(1, &entry.second.VBO);
+        if (entry.second.EBO != 0) {
+            glDeleteBuffers(1, &entry.second.EBO);
+        }
+    }
+    cache.clear();
+}
+
+/*
+Create the VAO of a model reading a shared mesh.
+The VAO is left bound so instance attributes can be added to it.
+@param model: Model to fill.
+@param shape: MESH_SHAPE_SPHERE, MESH_SHAPE_CYLINDER or MESH_SHAPE_QUAD.
+@param resolution: Initial resolution, see sharedMesh.
+*/
+void model::loadMesh(Model& model, unsigned int shape, int resolution) {
+    glGenVertexArrays(1, &model.VAO);
     glBindVertexArray(model.VAO);
-    glDrawArrays(GL_TRIANGLES, 0, model.vertexCount);
+    model::bindMesh(model, shape, resolution);
 }
 
 /*
-Load an atom model.
-@param atom_number: Atom number.
-@param atom_coord: Atom coordinate.
+Point the vertex attributes of the bound VAO at a shared mesh.
+The instance attributes are left as they are.
+@param model: Model whose VAO is bound.
+@param shape: MESH_SHAPE_SPHERE, MESH_SHAPE_CYLINDER or MESH_SHAPE_QUAD.
+@param resolution: Resolution, see sharedMesh.
 */
-model::Model model::loadAtomModel(
-    const unsigned int& atom_number,
-    const std::array<double, 3>& atom_coord
-) {
-    float sphere_radius = chem::VDWR_ARRAY[atom_number] * VDWR_SCALING_RATIO;
-    std::array<float, 3> sphere_color = chem::COLOR_ARRAY[atom_number - 1];
+void model::bindMesh(Model& model, unsigned int shape, int resolution) {
+    const MeshBuffer& mesh = model::sharedMesh(shape, resolution);
+    model.VBO = mesh.VBO;
+    model.meshShape = shape;
+    model.meshResolution = resolution;
+
+    glBindBuffer(GL_ARRAY_BUFFER, model.VBO);
+    if (mesh.EBO != 0) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+    }
 
-    model::Model sphere;
-    std::vector<float> vertices = SphereGenerator::generateVertices(sphere_radius, ATOM_MODEL_RESOLUTION*2, ATOM_MODEL_RESOLUTION);
-    
-    glGenVertexArrays(1, &sphere.VAO);
-    glGenBuffers(1, &sphere.VBO);
-    
-    glBindVertexArray(sphere.VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, sphere.VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
-    
     // Position attribute
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
     // Normal attribute
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
     glEnableVertexAttribArray(1);
-    
-    sphere.vertexCount = vertices.size() / 6;
-    sphere.transform = glm::translate(glm::mat4(1.0f), glm::vec3(atom_coord[0], atom_coord[1], atom_coord[2]));
-    // sphere.transform = glm::rotate(sphere.transform, glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));
-    // sphere.color = glm::vec3(0.3f, 0.8f, 0.3f); // Green
-    sphere.color = glm::vec3(sphere_color[0], sphere_color[1], sphere_color[2]);
 
-    return sphere;
+    model.vertexCount = mesh.vertexCount;
+    model.indexCount = mesh.indexCount;
 }
 
 /*
-Load a bond model.
-@param bond_vec: Bond vector.
+Mesh resolution for a sphere or cylinder of a given size on screen.
+The silhouette of a resolution r mesh has 2r edges; the smallest level
+keeping every edge within segmentPixels is used, capped at the finest level.
+@param radiusPixels: Radius on screen in pixels.
+@param segmentPixels: Longest silhouette edge in pixels.
 */
-model::Model model::loadBondModel(
-    const std::array<double, 6>& bond_vec
-) {
-    model::Model cylinder;
-    
-    // Calculate bond vector and length
-    glm::vec3 start = glm::vec3(bond_vec[0], bond_vec[1], bond_vec[2]);
-    glm::vec3 end = glm::vec3(bond_vec[3], bond_vec[4], bond_vec[5]);
-    glm::vec3 bondVector = end - start;
-    float bondLength = glm::length(bondVector);
-    
-    // Generate cylinder vertices with appropriate radius and the calculated length
-    float bondRadius = BOND_RADIUS;
-    std::vector<float> vertices = CylinderGenerator::generateVertices(
-        bondRadius, bondLength, BOND_MODEL_RESOLUTION*2, BOND_MODEL_RESOLUTION
-    );
-    
-    // Create OpenGL buffers
-    glGenVertexArrays(1, &cylinder.VAO);
-    glGenBuffers(1, &cylinder.VBO);
-    
-    glBindVertexArray(cylinder.VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, cylinder.VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), 
-                &vertices[0], GL_STATIC_DRAW);
-    
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // Normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    
-    cylinder.vertexCount = vertices.size() / 6;
-    
-    // Calculate transformation matrix to position and orient the cylinder
-    glm::vec3 midpoint = (start + end) * 0.5f;  // Center of the bond
-    
-    // Create rotation matrix to align cylinder with bond vector
-    glm::vec3 defaultDirection = glm::vec3(0.0f, 0.0f, 1.0f);  // Cylinder default direction
-    glm::vec3 bondDirection = glm::normalize(bondVector);
-    
-    glm::mat4 transform = glm::mat4(1.0f);
-    
-    // Translate to midpoint
-    transform = glm::translate(transform, midpoint);
-    
-    // Rotate to align with bond direction
-    // Check if we need to rotate at all
-    float dotProduct = glm::dot(defaultDirection, bondDirection);
-    if (abs(dotProduct) < 0.999f) {  // Not parallel or anti-parallel
-        glm::vec3 rotationAxis = glm::normalize(glm::cross(defaultDirection, bondDirection));
-        float rotationAngle = acos(glm::clamp(dotProduct, -1.0f, 1.0f));
-        transform = glm::rotate(transform, rotationAngle, rotationAxis);
-    } else if (dotProduct < 0) {
-        // Vectors are opposite (180-degree rotation needed)
-        // Choose an arbitrary perpendicular axis for 180-degree rotation
-        glm::vec3 perpAxis = glm::vec3(1.0f, 0.0f, 0.0f);
-        if (abs(glm::dot(defaultDirection, perpAxis)) > 0.9f) {
-            perpAxis = glm::vec3(0.0f, 1.0f, 0.0f);
+int model::levelOfDetail(float radiusPixels, float segmentPixels) {
+    const float PI = 3.14159265359f;
+    const float required = PI * radiusPixels / std::max(segmentPixels, 1e-3f);
+    for (int i = 0; i < MESH_LOD_COUNT; i++) {
+        if (MESH_LOD_RESOLUTIONS[i] >= required) {
+            return MESH_LOD_RESOLUTIONS[i];
         }
-        transform = glm::rotate(transform, glm::pi<float>(), perpAxis);
     }
+    return MESH_LOD_RESOLUTIONS[MESH_LOD_COUNT - 1];
+}
 
-    cylinder.transform = transform;
-    cylinder.color = glm::vec3(0.7f, 0.7f, 0.7f);  // Gray color for bonds
-    
-    return cylinder;
+/*
+Switch a sphere or cylinder model to the mesh resolution of its size on screen.
+Only the mesh attributes of the VAO are rebound, and only when the level changes.
+Impostor quads have no levels.
+@param model: Model.
+@param pixelsPerUnit: Pixels per world unit of the orthographic projection.
+@param outlineSize: Width the inverted-hull outline adds to the silhouette.
+@param segmentPixels: Longest silhouette edge in pixels.
+*/
+void model::setLevelOfDetail(Model& model, float pixelsPerUnit, float outlineSize, float segmentPixels) {
+    if (model.meshShape == MESH_SHAPE_QUAD) {
+        return;
+    }
+    const int resolution = model::levelOfDetail((model.instanceRadius + outlineSize) * pixelsPerUnit, segmentPixels);
+    if (resolution == model.meshResolution) {
+        return;
+    }
+    glBindVertexArray(model.VAO);
+    model::bindMesh(model, model.meshShape, resolution);
+    glBindVertexArray(0);
+}
+
+/*
+Upload one instance per atom to the bound VAO.
+The instance buffer holds the x, y and z arrays of the molecule as they are,
+followed by [radius, r, g, b] per atom.
+@param model: Model to fill.
+@param moleculeFile: Molecule file.
+*/
+void model::loadAtomInstances(Model& model, chem::MoleculeFile& moleculeFile) {
+    const size_t atom_count = moleculeFile.size();
+    const size_t coord_bytes = atom_count * sizeof(float);
+    std::vector<float> attributes(atom_count * 4);
+    model.instanceRadius = 0.0f;
+    for (size_t i = 0; i < atom_count; i++) {
+        const chem::Element& element = chem::ELEMENT_TABLE[moleculeFile.atomNumberArray[i] - 1];
+        const float radius = (float)element.vdwRadius * VDWR_SCALING_RATIO;
+        attributes[i * 4] = radius;
+        std::copy(element.color, element.color + 3, attributes.begin() + i * 4 + 1);
+        model.instanceRadius = std::max(model.instanceRadius, radius);
+    }
+
+    glGenBuffers(1, &model.instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, model.instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, 3 * coord_bytes + attributes.size() * sizeof(float), NULL, GL_STATIC_DRAW);
+    for (int k = 0; k < 3; k++) {
+        glBufferSubData(GL_ARRAY_BUFFER, k * coord_bytes, coord_bytes, moleculeFile.atomCoordArrays[k].data());
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 3 * coord_bytes, attributes.size() * sizeof(float), attributes.data());
+
+    // Instance center attributes, one per axis array
+    const GLuint center_locations[3] = {2, 5, 6};
+    for (int k = 0; k < 3; k++) {
+        glVertexAttribPointer(center_locations[k], 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)(k * coord_bytes));
+        glEnableVertexAttribArray(center_locations[k]);
+        glVertexAttribDivisor(center_locations[k], 1);
+    }
+    // Instance radius attribute
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(3 * coord_bytes));
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+    // Instance color attribute
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(3 * coord_bytes + sizeof(float)));
+    glEnableVertexAttribArray(4);
+    glVertexAttribDivisor(4, 1);
+
+    model.instanceCount = atom_count;
+}
+
+/*
+Upload one instance per bond to the bound VAO.
+The instance buffer holds only the two endpoints [x1, y1, z1, x2, y2, z2],
+written straight from the bond indices. Periodic bonds crossing the cell
+are split in two halves, see MoleculeFile::getBondVectorArray.
+@param model: Model to fill.
+@param moleculeFile: Molecule file.
+*/
+void model::loadBondInstances(Model& model, chem::MoleculeFile& moleculeFile) {
+    std::vector<float> instances;
+    if (moleculeFile.periodic) {
+        const std::vector<std::array<float, 6>> bond_vector_array =
+            moleculeFile.getBondVectorArray();
+        instances.resize(bond_vector_array.size() * 6);
+        for (size_t i = 0; i < bond_vector_array.size(); i++) {
+            std::copy(bond_vector_array[i].begin(), bond_vector_array[i].end(), instances.begin() + i * 6);
+        }
+    } else {
+        const std::vector<chem::BondIndex> bond_index_array =
+            moleculeFile.getBondIndexArray();
+        instances.resize(bond_index_array.size() * 6);
+        for (size_t i = 0; i < bond_index_array.size(); i++) {
+            for (int k = 0; k < 3; k++) {
+                const float* coords = moleculeFile.atomCoordArrays[k].data();
+                instances[i * 6 + k] = coords[bond_index_array[i][0]];
+                instances[i * 6 + 3 + k] = coords[bond_index_array[i][1]];
+            }
+        }
+    }
+
+    glGenBuffers(1, &model.instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, model.instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(float), instances.data(), GL_STATIC_DRAW);
+
+    // Instance start point attribute
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    // Instance end point attribute
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+
+    model.instanceCount = instances.size() / 6;
+}
+
+/*
+Load all atoms of a molecule as one instanced model.
+Every atom shares a unit sphere scaled by its per-instance radius.
+@param moleculeFile: Molecule file.
+*/
+model::Model model::loadAtomModel(chem::MoleculeFile& moleculeFile) {
+    model::Model spheres;
+    model::loadMesh(spheres, MESH_SHAPE_SPHERE, ATOM_MODEL_RESOLUTION);
+    model::loadAtomInstances(spheres, moleculeFile);
+    spheres.type = MODEL_TYPE_ATOMS;
+
+    return spheres;
+}
+
+/*
+Load all bonds of a molecule as one instanced model.
+Every bond shares a unit cylinder along z; the vertex shader orients
+and stretches the cylinder between the two endpoints.
+@param moleculeFile: Molecule file.
+*/
+model::Model model::loadBondModel(chem::MoleculeFile& moleculeFile) {
+    model::Model cylinders;
+    model::loadMesh(cylinders, MESH_SHAPE_CYLINDER, BOND_MODEL_RESOLUTION);
+    cylinders.instanceRadius = BOND_RADIUS;
+    model::loadBondInstances(cylinders, moleculeFile);
+    cylinders.type = MODEL_TYPE_BONDS;
+    cylinders.color = glm::vec3(0.7f, 0.7f, 0.7f);  // Gray color for bonds
+
+    return cylinders;
+}
+
+/*
+Load all atoms of a molecule as ray-cast sphere impostors.
+Each atom is a camera-facing quad of 4 vertices; the fragment shader
+intersects the exact sphere and writes its depth.
+@param moleculeFile: Molecule file.
+*/
+model::Model model::loadAtomImpostorModel(chem::MoleculeFile& moleculeFile) {
+    model::Model spheres;
+    model::loadMesh(spheres, MESH_SHAPE_QUAD, 0);
+    model::loadAtomInstances(spheres, moleculeFile);
+    spheres.type = MODEL_TYPE_ATOM_IMPOSTORS;
+    spheres.primitive = GL_TRIANGLE_STRIP;
+
+    return spheres;
+}
+
+/*
+Load all bonds of a molecule as ray-cast cylinder impostors.
+Each bond is a quad spanning its screen-space extent; the fragment shader
+intersects the exact cylinder and writes its depth.
+@param moleculeFile: Molecule file.
+*/
+model::Model model::loadBondImpostorModel(chem::MoleculeFile& moleculeFile) {
+    model::Model cylinders;
+    model::loadMesh(cylinders, MESH_SHAPE_QUAD, 0);
+    model::loadBondInstances(cylinders, moleculeFile);
+    cylinders.type = MODEL_TYPE_BOND_IMPOSTORS;
+    cylinders.primitive = GL_TRIANGLE_STRIP;
+    cylinders.color = glm::vec3(0.7f, 0.7f, 0.7f);  // Gray color for bonds
+
+    return cylinders;
 }
 
 
@@ -197,21 +472,11 @@ Load a molecule model.
 std::vector<model::Model> model::loadMoleculeModel(chem::MoleculeFile& moleculeFile){
     std::vector<model::Model> models;
 
-    const size_t atom_count = moleculeFile.size();
-    for (size_t i = 0; i < atom_count; i++){
-        models.push_back(
-            model::loadAtomModel(
-                moleculeFile.atomNumberArray[i],
-                moleculeFile.atomCoordArray[i]
-            )
-        );
+    if (moleculeFile.size() > 0){
+        models.push_back(model::loadAtomModel(moleculeFile));
     }
 
-    const std::vector<std::array<double, 6>> bond_vector_array =
-        moleculeFile.getBondVectorArray();
-    for (size_t i = 0; i < bond_vector_array.size(); i++){
-        models.push_back(model::loadBondModel(bond_vector_array[i]));
-    }
+    models.push_back(model::loadBondModel(moleculeFile));
 
     glBindVertexArray(0);
     return models;
@@ -228,16 +493,8 @@ std::vector<model::Model> model::loadMoleculeModel(
     std::vector<model::Model> models;
 
     // Atom
-    if (mode == MODEL_MODEL_CPK){
-        const size_t atom_count = moleculeFile.size();
-        for (size_t i = 0; i < atom_count; i++){
-            models.push_back(
-                model::loadAtomModel(
-                    moleculeFile.atomNumberArray[i],
-                    moleculeFile.atomCoordArray[i]
-                )
-            );
-        }
+    if ((mode == MODEL_MODEL_CPK) && (moleculeFile.size() > 0)){
+        models.push_back(model::loadAtomModel(moleculeFile));
     }
 
     // Bond
@@ -245,11 +502,13 @@ std::vector<model::Model> model::loadMoleculeModel(
         (mode == MODEL_MODEL_LINE)
         || (mode == MODEL_MODEL_CPK)
     ){
-        const std::vector<std::array<double, 6>> bond_vector_array =
-            moleculeFile.getBondVectorArray();
-        for (size_t i = 0; i < bond_vector_array.size(); i++){
-            models.push_back(model::loadBondModel(bond_vector_array[i]));
-        }
+        models.push_back(model::loadBondModel(moleculeFile));
+    }
+
+    // Impostor atoms and bonds
+    if ((mode == MODEL_MODEL_IMPOSTOR) && (moleculeFile.size() > 0)){
+        models.push_back(model::loadAtomImpostorModel(moleculeFile));
+        models.push_back(model::loadBondImpostorModel(moleculeFile));
     }
 
     glBindVertexArray(0);
@@ -257,13 +516,51 @@ std::vector<model::Model> model::loadMoleculeModel(
 }
 
 /*
-Cleanup models.
+Draw the models of a periodic molecule as a supercell of cells x cells x cells images.
+The images share the models' buffers and only move them by lattice vectors,
+centred on the original cell. Molecules without a lattice are left as one copy.
+@param models: Models of the molecule.
+@param moleculeFile: Molecule file with the lattice.
+@param cells: Images along a, b and c.
+*/
+void model::setPeriodicImages(
+    std::vector<Model>& models,
+    const chem::MoleculeFile& moleculeFile,
+    const std::array<int, 3>& cells
+) {
+    std::vector<glm::vec3> offsets;
+    if (moleculeFile.periodic && cells[0] * cells[1] * cells[2] > 1) {
+        const std::array<std::array<double, 3>, 3>& lattice = moleculeFile.cell.vectors;
+        const glm::vec3 a((float)lattice[0][0], (float)lattice[0][1], (float)lattice[0][2]);
+        const glm::vec3 b((float)lattice[1][0], (float)lattice[1][1], (float)lattice[1][2]);
+        const glm::vec3 c((float)lattice[2][0], (float)lattice[2][1], (float)lattice[2][2]);
+        for (int k = 0; k < cells[2]; k++) {
+            for (int j = 0; j < cells[1]; j++) {
+                for (int i = 0; i < cells[0]; i++) {
+                    offsets.push_back(
+                        a * (i - (cells[0] - 1) * 0.5f)
+                        + b * (j - (cells[1] - 1) * 0.5f)
+                        + c * (k - (cells[2] - 1) * 0.5f)
+                    );
+                }
+            }
+        }
+    }
+    for (Model& model : models) {
+        model.imageOffsets = offsets;
+    }
+}
+
+/*
+Cleanup models. Their meshes stay in the cache for the next models.
 @param models: Models to cleanup.
 */
 void model::cleanupModels(std::vector<Model>& models) {
     for (auto& model : models) {
         glDeleteVertexArrays(1, &model.VAO);
-        glDeleteBuffers(1, &model.VBO);
+        if (model.instanceVBO != 0) {
+            glDeleteBuffers(1, &model.instanceVBO);
+        }
     }
     models.clear();
 }
@@ -1,7 +1,12 @@
 #pragma once
 
+#include<algorithm>
 #include<array>
 #include<cmath>
+#include<cstdint>
+#include<limits>
+#include<new>
+#include<thread>
 #include<vector>
 
 
@@ -9,23 +14,98 @@
 
 
 namespace chem{
+    // Index of an atom within a molecule, 32 bits keeps bond lists compact
+    typedef unsigned int AtomIndex;
+    // Indices of the two atoms of a bond
+    typedef std::array<AtomIndex, 2> BondIndex;
+    const size_t MAX_ATOM_COUNT = std::numeric_limits<AtomIndex>::max();
+    // Smaller molecules are searched for bonds on one thread, starting threads costs more
+    const size_t BOND_SEARCH_ATOMS_PER_THREAD = 32768;
+    // Bits per axis of a packed cell key of the bond search, and the cells per axis they hold
+    const int CELL_KEY_BITS = 21;
+    const uint64_t CELL_KEY_LIMIT = (uint64_t)1 << CELL_KEY_BITS;
+    // Boxes with at most this many grid cells per atom index their cells directly
+    const size_t CELL_TABLE_CELLS_PER_ATOM = 4;
+    // Coordinate arrays start on this boundary, the widest SIMD register in bytes
+    const size_t COORD_ALIGNMENT = 32;
+
+    /*
+    Allocator for std::vector returning memory aligned to Alignment bytes.
+    The pointer from operator new is kept just before the aligned block.
+    */
+    template <typename T, size_t Alignment>
+    struct AlignedAllocator{
+        typedef T value_type;
+        template <typename U> struct rebind{ typedef AlignedAllocator<U, Alignment> other; };
+
+        AlignedAllocator(){}
+        template <typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&){}
+
+        T* allocate(size_t n){
+            char* raw = static_cast<char*>(::operator new(n * sizeof(T) + Alignment + sizeof(void*)));
+            const uintptr_t aligned = (reinterpret_cast<uintptr_t>(raw) + sizeof(void*) + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+            reinterpret_cast<void**>(aligned)[-1] = raw;
+            return reinterpret_cast<T*>(aligned);
+        }
+        void deallocate(T* p, size_t){
+            ::operator delete(reinterpret_cast<void**>(p)[-1]);
+        }
+    };
+    template <typename T, typename U, size_t Alignment>
+    bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&){ return true; }
+    template <typename T, typename U, size_t Alignment>
+    bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&){ return false; }
+
+    // One coordinate of every atom
+    typedef std::vector<float, AlignedAllocator<float, COORD_ALIGNMENT>> CoordArray;
+
     double getBondLength(const std::array<double, 3>& atom_coord_1, const std::array<double, 3>& atom_coord_2);
+    uint64_t cellKey(uint64_t x, uint64_t y, uint64_t z);
+
+    /*
+    Periodic cell spanned by the lattice vectors a, b and c
+    */
+    struct UnitCell{
+        std::array<std::array<double, 3>, 3> vectors;   // a, b and c
+        std::array<std::array<double, 3>, 3> inverse;   // Rows map cartesian to fractional coordinates
+
+        bool set(const std::array<std::array<double, 3>, 3>& lattice);
+        std::array<double, 3> toFractional(const std::array<double, 3>& coord) const;
+        std::array<double, 3> minimumImage(const std::array<double, 3>& delta) const;
+        double width(int axis) const;
+    };
 
     class MoleculeFile{
         public:
             MoleculeFile();
             ~MoleculeFile();
             
-            std::vector<unsigned int> atomNumberArray;
-            std::vector<std::array<double, 3>> atomCoordArray;
+            // Structure of arrays: atomic numbers and one float array per axis,
+            // atomCoordArrays[0][i] is the x coordinate of atom i
+            std::vector<uint8_t> atomNumberArray;
+            std::array<CoordArray, 3> atomCoordArrays;
+            // Set when the file gives a lattice, bonds then follow the minimum image
+            bool periodic;
+            UnitCell cell;
 
             const size_t size(void);
-            const std::vector<std::array<unsigned short, 2>> getBondIndexArray(void);
-            const std::vector<std::array<double, 6>> getBondVectorArray(void);
+            void resize(size_t atom_count);
+            std::array<double, 3> atomCoord(size_t i) const;
+            const std::vector<BondIndex> getBondIndexArray(void);
+            const std::vector<std::array<float, 6>> getBondVectorArray(void);
             const std::array<double, 3> getGeomCenter(void);
+            std::array<double, 3> bondDisplacement(size_t i, size_t j) const;
     };
 }
 
+/*
+Pack the cell coordinates of the bond search into one sortable key, x in the low bits.
+Each coordinate must be below CELL_KEY_LIMIT.
+*/
+uint64_t chem::cellKey(uint64_t x, uint64_t y, uint64_t z){
+    return (z << (2 * CELL_KEY_BITS)) | (y << CELL_KEY_BITS) | x;
+}
+
 double chem::getBondLength(const std::array<double, 3>& atom_coord_1, const std::array<double, 3>& atom_coord_2){
     return sqrt(
         pow(atom_coord_1[0] - atom_coord_2[0], 2)
@@ -34,7 +114,66 @@ double chem::getBondLength(const std::array<double, 3>& atom_coord_1, const std:
     );
 }
 
-chem::MoleculeFile::MoleculeFile(){}
+/*
+Set the lattice vectors.
+@param lattice: a, b and c.
+@return: false if the vectors do not span a volume, the cell is left unchanged.
+*/
+bool chem::UnitCell::set(const std::array<std::array<double, 3>, 3>& lattice){
+    const std::array<double, 3>& a = lattice[0];
+    const std::array<double, 3>& b = lattice[1];
+    const std::array<double, 3>& c = lattice[2];
+    // Rows of the inverse are the reciprocal vectors b x c, c x a and a x b over the volume
+    const std::array<std::array<double, 3>, 3> cross = {{
+        {{b[1] * c[2] - b[2] * c[1], b[2] * c[0] - b[0] * c[2], b[0] * c[1] - b[1] * c[0]}},
+        {{c[1] * a[2] - c[2] * a[1], c[2] * a[0] - c[0] * a[2], c[0] * a[1] - c[1] * a[0]}},
+        {{a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]}}
+    }};
+    const double volume = a[0] * cross[0][0] + a[1] * cross[0][1] + a[2] * cross[0][2];
+    if (!(std::fabs(volume) > 1e-9)){
+        return false;
+    }
+    this->vectors = lattice;
+    for (int i = 0; i < 3; i++){
+        for (int k = 0; k < 3; k++){
+            this->inverse[i][k] = cross[i][k] / volume;
+        }
+    }
+    return true;
+}
+
+std::array<double, 3> chem::UnitCell::toFractional(const std::array<double, 3>& coord) const{
+    std::array<double, 3> fractional;
+    for (int i = 0; i < 3; i++){
+        fractional[i] = this->inverse[i][0] * coord[0] + this->inverse[i][1] * coord[1] + this->inverse[i][2] * coord[2];
+    }
+    return fractional;
+}
+
+/*
+Shortest periodic image of a displacement, exact for cells that are not strongly skewed.
+*/
+std::array<double, 3> chem::UnitCell::minimumImage(const std::array<double, 3>& delta) const{
+    const std::array<double, 3> fractional = this->toFractional(delta);
+    std::array<double, 3> image = delta;
+    for (int i = 0; i < 3; i++){
+        const double shift = std::floor(fractional[i] + 0.5);
+        for (int k = 0; k < 3; k++){
+            image[k] -= shift * this->vectors[i][k];
+        }
+    }
+    return image;
+}
+
+/*
+Distance between the two faces of the cell normal to the plane of the other two vectors.
+*/
+double chem::UnitCell::width(int axis) const{
+    const std::array<double, 3>& reciprocal = this->inverse[axis];
+    return 1.0 / std::sqrt(reciprocal[0] * reciprocal[0] + reciprocal[1] * reciprocal[1] + reciprocal[2] * reciprocal[2]);
+}
+
+chem::MoleculeFile::MoleculeFile() : periodic(false){}
 
 chem::MoleculeFile::~MoleculeFile(){}
 
@@ -42,53 +181,277 @@ const size_t chem::MoleculeFile::size(void){
     return (size_t)this->atomNumberArray.size();
 }
 
-const std::vector<std::array<unsigned short, 2>> chem::MoleculeFile::getBondIndexArray(void){
-    double exp_bond_length = 0.;
-    double actl_bond_length = 0.;
-    std::vector<std::array<unsigned short, 2>> bond_index_array;
-
-    for (int i = 0; i < this->atomNumberArray.size(); i++){
-        for (int j = i + 1; j < this->atomNumberArray.size(); j++){
-            exp_bond_length = chem::getExpectedBondLengh(this->atomNumberArray[i], this->atomNumberArray[j]);
-            actl_bond_length = chem::getBondLength(this->atomCoordArray[i], this->atomCoordArray[j]);
-            if (exp_bond_length > actl_bond_length){
-                bond_index_array.push_back(
-                    {static_cast<unsigned short>(i), static_cast<unsigned short>(j)}
-                );
+/*
+Resize the atomic numbers and all three coordinate arrays together.
+@param atom_count: New number of atoms, atoms below it are kept.
+*/
+void chem::MoleculeFile::resize(size_t atom_count){
+    this->atomNumberArray.resize(atom_count);
+    for (int k = 0; k < 3; k++){
+        this->atomCoordArrays[k].resize(atom_count);
+    }
+}
+
+/*
+Coordinates of one atom, gathered from the three arrays.
+*/
+std::array<double, 3> chem::MoleculeFile::atomCoord(size_t i) const{
+    return {{this->atomCoordArrays[0][i], this->atomCoordArrays[1][i], this->atomCoordArrays[2][i]}};
+}
+
+/*
+Find bonded atom pairs with a uniform cell list. Atoms are bonded when they are
+closer than their covalent radii plus BOND_TOLERANCE, see BondCutoffTable.
+Cells are at least as wide as the longest bond cutoff among the elements present,
+so every bonded partner of an atom lies in its own cell or one of the 26 neighbours.
+Only occupied cells are kept, sorted by key, so the cost follows the atom count
+however sparse the bounding box is.
+A periodic molecule is binned in fractional coordinates, the neighbours wrap around
+the cell and distances are taken to the nearest image of the partner.
+Large molecules are split into contiguous ranges of atoms, one per hardware thread,
+each filling its own list; appending the lists in range order keeps the result sorted.
+Pairs are returned sorted by (i, j) with i < j, the same as a full pairwise scan.
+*/
+const std::vector<chem::BondIndex> chem::MoleculeFile::getBondIndexArray(void){
+    std::vector<chem::BondIndex> bond_index_array;
+    const size_t atom_count = this->atomNumberArray.size();
+    if (atom_count < 2){
+        return bond_index_array;
+    }
+
+    // Cell edge = longest bond cutoff of any two present elements
+    unsigned int widest_element = this->atomNumberArray[0];
+    for (size_t i = 1; i < atom_count; i++){
+        if (chem::ELEMENT_TABLE[this->atomNumberArray[i] - 1].covalentRadius > chem::ELEMENT_TABLE[widest_element - 1].covalentRadius){
+            widest_element = this->atomNumberArray[i];
+        }
+    }
+    std::array<double, 3> box_min;
+    std::array<double, 3> box_max;
+    for (int k = 0; k < 3; k++){
+        const std::pair<CoordArray::const_iterator, CoordArray::const_iterator> range =
+            std::minmax_element(this->atomCoordArrays[k].begin(), this->atomCoordArrays[k].end());
+        box_min[k] = *range.first;
+        box_max[k] = *range.second;
+    }
+    const chem::BondCutoffTable& cutoffs = chem::bondCutoffs();
+    const double cell_size = std::sqrt((double)chem::getBondCutoffSquared(widest_element, widest_element));
+    if (!(cell_size > 0.)){
+        return bond_index_array;
+    }
+
+    // Cells per axis, capped so a cell coordinate fits CELL_KEY_BITS; atoms beyond
+    // the cap share the last cell, which only costs time, never a missed bond.
+    // Computed in double so huge or non-finite extents cannot overflow the cast.
+    std::array<uint64_t, 3> cell_dims;
+    for (int k = 0; k < 3; k++){
+        const double extent = this->periodic
+            ? std::floor(this->cell.width(k) / cell_size)
+            : std::floor((box_max[k] - box_min[k]) / cell_size) + 1;
+        cell_dims[k] = extent >= 1. ? (extent < (double)CELL_KEY_LIMIT ? (uint64_t)extent : CELL_KEY_LIMIT) : 1;
+    }
+
+    // Only occupied cells are stored: atoms sorted by packed cell key, then index,
+    // so a sparse box (one far-off atom, a slab with vacuum) keeps cells one cutoff wide
+    std::vector<std::pair<uint64_t, chem::AtomIndex>> keyed_atoms(atom_count);
+    for (size_t i = 0; i < atom_count; i++){
+        // Fractional coordinates when periodic, cartesian otherwise
+        const std::array<double, 3> coord = this->periodic
+            ? this->cell.toFractional(this->atomCoord(i)) : this->atomCoord(i);
+        uint64_t c[3];
+        for (int k = 0; k < 3; k++){
+            const double position = this->periodic
+                ? (coord[k] - std::floor(coord[k])) * cell_dims[k]
+                : (coord[k] - box_min[k]) / cell_size;
+            c[k] = position >= 0. ? (position < (double)(cell_dims[k] - 1) ? (uint64_t)position : cell_dims[k] - 1) : 0;
+        }
+        keyed_atoms[i] = std::make_pair(chem::cellKey(c[0], c[1], c[2]), static_cast<chem::AtomIndex>(i));
+    }
+    std::sort(keyed_atoms.begin(), keyed_atoms.end());
+    std::vector<uint64_t> atom_key(atom_count);
+    std::vector<uint64_t> cell_keys;
+    std::vector<chem::AtomIndex> cell_start;
+    std::vector<chem::AtomIndex> cell_atoms(atom_count);
+    for (size_t n = 0; n < atom_count; n++){
+        if (n == 0 || keyed_atoms[n].first != keyed_atoms[n - 1].first){
+            cell_keys.push_back(keyed_atoms[n].first);
+            cell_start.push_back(n);
+        }
+        cell_atoms[n] = keyed_atoms[n].second;
+        atom_key[keyed_atoms[n].second] = keyed_atoms[n].first;
+    }
+    cell_start.push_back(atom_count);
+    std::vector<std::pair<uint64_t, chem::AtomIndex>>().swap(keyed_atoms);
+
+    // A compact box also gets a table from every cell to its occupied slot, so a lookup
+    // costs one read; a sparse one searches the sorted keys instead
+    const double grid_cells = (double)cell_dims[0] * (double)cell_dims[1] * (double)cell_dims[2];
+    std::vector<chem::AtomIndex> cell_slot;
+    if (grid_cells <= (double)(CELL_TABLE_CELLS_PER_ATOM * atom_count)){
+        cell_slot.assign((size_t)grid_cells, static_cast<chem::AtomIndex>(cell_keys.size()));
+        for (size_t c = 0; c < cell_keys.size(); c++){
+            const uint64_t key = cell_keys[c];
+            cell_slot[((key >> (2 * CELL_KEY_BITS)) * cell_dims[1] + ((key >> CELL_KEY_BITS) & (CELL_KEY_LIMIT - 1))) * cell_dims[0]
+                + (key & (CELL_KEY_LIMIT - 1))] = c;
+        }
+    }
+    // Slot of an occupied cell, cell_keys.size() if the cell is empty
+    auto find_cell = [&](uint64_t x, uint64_t y, uint64_t z) -> size_t {
+        if (!cell_slot.empty()){
+            return cell_slot[(z * cell_dims[1] + y) * cell_dims[0] + x];
+        }
+        const uint64_t key = chem::cellKey(x, y, z);
+        const std::vector<uint64_t>::const_iterator found =
+            std::lower_bound(cell_keys.begin(), cell_keys.end(), key);
+        return found != cell_keys.end() && *found == key ? found - cell_keys.begin() : cell_keys.size();
+    };
+
+    // Bonds from atoms [first, last) to partners with a larger index, sorted
+    auto find_bonds = [&](size_t first, size_t last, std::vector<chem::BondIndex>& bonds){
+        std::vector<chem::AtomIndex> neighbours;
+        for (size_t i = first; i < last; i++){
+            const uint64_t cell_coord[3] = {
+                atom_key[i] & (CELL_KEY_LIMIT - 1),
+                (atom_key[i] >> CELL_KEY_BITS) & (CELL_KEY_LIMIT - 1),
+                atom_key[i] >> (2 * CELL_KEY_BITS)
+            };
+
+            // Surrounding cells along each axis, wrapped and without repeats when periodic
+            uint64_t around[3][3];
+            size_t around_count[3];
+            for (int k = 0; k < 3; k++){
+                const uint64_t c = cell_coord[k];
+                const uint64_t n = cell_dims[k];
+                around_count[k] = 0;
+                if (this->periodic){
+                    const uint64_t candidates[3] = {c, (c + 1) % n, (c + n - 1) % n};
+                    for (int m = 0; m < 3; m++){
+                        if (std::find(around[k], around[k] + around_count[k], candidates[m]) == around[k] + around_count[k]){
+                            around[k][around_count[k]++] = candidates[m];
+                        }
+                    }
+                } else {
+                    for (uint64_t a = (c > 0 ? c - 1 : 0); a <= std::min(c + 1, n - 1); a++){
+                        around[k][around_count[k]++] = a;
+                    }
+                }
+            }
+
+            // Gather partners with a larger index from the occupied surrounding cells
+            neighbours.clear();
+            for (size_t az = 0; az < around_count[2]; az++){
+                for (size_t ay = 0; ay < around_count[1]; ay++){
+                    for (size_t ax = 0; ax < around_count[0]; ax++){
+                        const size_t c = find_cell(around[0][ax], around[1][ay], around[2][az]);
+                        if (c == cell_keys.size()){
+                            continue;
+                        }
+                        for (size_t n = cell_start[c]; n < cell_start[c + 1]; n++){
+                            if (cell_atoms[n] > i){
+                                neighbours.push_back(cell_atoms[n]);
+                            }
+                        }
+                    }
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end());
+
+            // Squared distances against the row of squared cutoffs of atom i
+            const float* cutoff_row = cutoffs.squared[this->atomNumberArray[i] - 1];
+            for (size_t n = 0; n < neighbours.size(); n++){
+                const size_t j = neighbours[n];
+                const std::array<double, 3> d = this->bondDisplacement(i, j);
+                const double distance_squared = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+                if (distance_squared < cutoff_row[this->atomNumberArray[j] - 1]){
+                    bonds.push_back(
+                        {static_cast<chem::AtomIndex>(i), static_cast<chem::AtomIndex>(j)}
+                    );
+                }
             }
         }
+    };
+
+    const size_t thread_count = std::max<size_t>(1, std::min<size_t>(
+        std::thread::hardware_concurrency(), atom_count / BOND_SEARCH_ATOMS_PER_THREAD
+    ));
+    if (thread_count == 1){
+        find_bonds(0, atom_count, bond_index_array);
+        return bond_index_array;
+    }
+
+    // The calling thread takes the first range and writes straight into the result
+    const size_t atoms_per_thread = (atom_count + thread_count - 1) / thread_count;
+    std::vector<std::vector<chem::BondIndex>> thread_bonds(thread_count - 1);
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < thread_count; t++){
+        const size_t first = std::min(t * atoms_per_thread, atom_count);
+        const size_t last = std::min(first + atoms_per_thread, atom_count);
+        workers.push_back(std::thread(find_bonds, first, last, std::ref(thread_bonds[t - 1])));
+    }
+    find_bonds(0, std::min(atoms_per_thread, atom_count), bond_index_array);
+    size_t bond_count = bond_index_array.size();
+    for (size_t t = 0; t < workers.size(); t++){
+        workers[t].join();
+        bond_count += thread_bonds[t].size();
+    }
+    bond_index_array.reserve(bond_count);
+    for (size_t t = 0; t < thread_bonds.size(); t++){
+        bond_index_array.insert(bond_index_array.end(), thread_bonds[t].begin(), thread_bonds[t].end());
     }
     return bond_index_array;
 }
 
-const std::vector<std::array<double, 6>> chem::MoleculeFile::getBondVectorArray(void){
-    std::vector<std::array<double, 6>> bond_vector_array;
-    std::vector<std::array<unsigned short, 2>> bond_index_array =
+/*
+Vector from atom i to the nearest image of atom j.
+*/
+std::array<double, 3> chem::MoleculeFile::bondDisplacement(size_t i, size_t j) const{
+    const std::array<double, 3> delta = {{
+        (double)this->atomCoordArrays[0][j] - this->atomCoordArrays[0][i],
+        (double)this->atomCoordArrays[1][j] - this->atomCoordArrays[1][i],
+        (double)this->atomCoordArrays[2][j] - this->atomCoordArrays[2][i]
+    }};
+    return this->periodic ? this->cell.minimumImage(delta) : delta;
+}
+
+/*
+Start and end point [x1, y1, z1, x2, y2, z2] of every bond.
+A periodic bond to an image of its partner is drawn as two halves, one from each
+atom towards the other's image, so neighbouring cells of a supercell join up.
+*/
+const std::vector<std::array<float, 6>> chem::MoleculeFile::getBondVectorArray(void){
+    const std::vector<chem::BondIndex> bond_index_array =
         this->getBondIndexArray();
-    std::array<double, 3> v1 = {0.0, 0.0, 0.0};
-    std::array<double, 3> v2 = {0.0, 0.0, 0.0};
-    for (int i = 0; i < bond_index_array.size(); i++){
-        v1 = this->atomCoordArray[bond_index_array[i][0]];
-        v2 = this->atomCoordArray[bond_index_array[i][1]];
-        bond_vector_array.push_back(
-            {
-                v1[0], v1[1], v1[2],
-                v2[0], v2[1], v2[2]
-            }
-        );
+    std::vector<std::array<float, 6>> bond_vector_array(bond_index_array.size());
+    for (size_t i = 0; i < bond_index_array.size(); i++){
+        const size_t a = bond_index_array[i][0];
+        const size_t b = bond_index_array[i][1];
+        const std::array<double, 3> v1 = this->atomCoord(a);
+        const std::array<double, 3> v2 = this->atomCoord(b);
+        bond_vector_array[i] = {{(float)v1[0], (float)v1[1], (float)v1[2], (float)v2[0], (float)v2[1], (float)v2[2]}};
+        if (!this->periodic){
+            continue;
+        }
+        const std::array<double, 3> d = this->bondDisplacement(a, b);
+        if (std::fabs(v1[0] + d[0] - v2[0]) + std::fabs(v1[1] + d[1] - v2[1]) + std::fabs(v1[2] + d[2] - v2[2]) > 1e-6){
+            bond_vector_array[i] = {{(float)v1[0], (float)v1[1], (float)v1[2],
+                (float)(v1[0] + d[0] / 2), (float)(v1[1] + d[1] / 2), (float)(v1[2] + d[2] / 2)}};
+            bond_vector_array.push_back({{(float)v2[0], (float)v2[1], (float)v2[2],
+                (float)(v2[0] - d[0] / 2), (float)(v2[1] - d[1] / 2), (float)(v2[2] - d[2] / 2)}});
+        }
     }
     return bond_vector_array;
 }
 
 const std::array<double, 3> chem::MoleculeFile::getGeomCenter(void){
     std::array<double, 3> geom_center = {0.0, 0.0, 0.0};
-    for (int i = 0; i < this->atomCoordArray.size(); i++){
-        geom_center[0] += this->atomCoordArray[i][0];
-        geom_center[1] += this->atomCoordArray[i][1];
-        geom_center[2] += this->atomCoordArray[i][2];
-    }
-    geom_center[0] /= this->atomCoordArray.size();
-    geom_center[1] /= this->atomCoordArray.size();
-    geom_center[2] /= this->atomCoordArray.size();
+    const size_t atom_count = this->size();
+    for (int k = 0; k < 3; k++){
+        const float* coords = this->atomCoordArrays[k].data();
+        double sum = 0.0;
+        for (size_t i = 0; i < atom_count; i++){
+            sum += coords[i];
+        }
+        geom_center[k] = sum / atom_count;
+    }
     return geom_center;
 }
\ No newline at end of file
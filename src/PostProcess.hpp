@@ -0,0 +1,413 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <iostream>
+
+#include "Shader.hpp"
+
+
+// Outline modes
+extern const unsigned int OUTLINE_MODE_HULL = 0;      // Second draw of every model with an inverted hull
+extern const unsigned int OUTLINE_MODE_SCREEN = 1;    // Edge detection on the depth buffer after a single draw
+
+// Transparency modes
+extern const unsigned int TRANSPARENCY_MODE_BLENDED = 0;    // Translucent layers blended in draw order, unsorted
+extern const unsigned int TRANSPARENCY_MODE_WEIGHTED = 1;   // Weighted blended order-independent transparency
+
+
+namespace postprocess{
+    /*
+    Offscreen target the scene is drawn into before the screen-space passes.
+    Color, layer alpha and depth are kept as textures so they can be sampled.
+    */
+    struct SceneTarget {
+        unsigned int FBO;
+        unsigned int colorTexture;      // Shaded scene, blended over the background
+        unsigned int alphaTexture;      // Alpha of the front-most layer, 0 for the background
+        unsigned int depthTexture;
+        unsigned int VAO;               // Empty VAO for the full-screen triangle
+        int width;
+        int height;
+
+        SceneTarget() : FBO(0), colorTexture(0), alphaTexture(0), depthTexture(0),
+                VAO(0), width(0), height(0) {}
+    };
+
+    /*
+    Accumulation target of weighted blended order-independent transparency.
+    Translucent layers are summed here in one unsorted pass, tested against a copy
+    of the opaque depth, then composited over the framebuffer they were drawn for.
+    */
+    struct TransparencyTarget {
+        unsigned int FBO;
+        unsigned int accumTexture;      // Sum of weighted premultiplied colors, alpha is the revealage
+        unsigned int weightTexture;     // Sum of the weights
+        unsigned int depthRenderbuffer; // Copy of the opaque depth
+        unsigned int VAO;               // Empty VAO for the full-screen triangle
+        int width;
+        int height;
+        GLenum depthFormat;             // Matches the output framebuffer, so its depth can be blitted
+        GLint outputFBO;                // Framebuffer bound when the pass began
+        GLint outputViewport[4];
+        bool outputBlend1;              // Blending of draw buffer 1 when the pass began
+
+        TransparencyTarget() : FBO(0), accumTexture(0), weightTexture(0), depthRenderbuffer(0),
+                VAO(0), width(0), height(0), depthFormat(GL_NONE), outputFBO(0), outputBlend1(false) {
+            outputViewport[0] = outputViewport[1] = outputViewport[2] = outputViewport[3] = 0;
+        }
+    };
+
+    bool resizeSceneTarget(SceneTarget& target, int width, int height);
+    void beginScene(const SceneTarget& target, const float* backgroundColor);
+    void drawScreenOutline(const SceneTarget& target, const shader::Shader& shader, unsigned int outputFBO);
+    void cleanupSceneTarget(SceneTarget& target);
+    GLenum framebufferDepthFormat(GLint FBO);
+    bool resizeTransparencyTarget(TransparencyTarget& target, int width, int height, GLenum depthFormat);
+    bool beginTransparency(TransparencyTarget& target);
+    void endTransparency(const TransparencyTarget& target, const shader::Shader& shader);
+    void cleanupTransparencyTarget(TransparencyTarget& target);
+}
+
+
+/*
+Create the scene target, or recreate it when the size has changed.
+@param target: Scene target.
+@param width: Width in pixels.
+@param height: Height in pixels.
+@return: false if the framebuffer is not complete.
+*/
+bool postprocess::resizeSceneTarget(SceneTarget& target, int width, int height)
+{
+    if (target.FBO != 0 && target.width == width && target.height == height) {
+        return true;
+    }
+    cleanupSceneTarget(target);
+    target.width = width;
+    target.height = height;
+
+    glGenFramebuffers(1, &target.FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.FBO);
+
+    // Color texture
+    glGenTextures(1, &target.colorTexture);
+    glBindTexture(GL_TEXTURE_2D, target.colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.colorTexture, 0);
+
+    // Layer alpha texture
+    glGenTextures(1, &target.alphaTexture);
+    glBindTexture(GL_TEXTURE_2D, target.alphaTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, target.alphaTexture, 0);
+
+    // Depth texture
+    glGenTextures(1, &target.depthTexture);
+    glBindTexture(GL_TEXTURE_2D, target.depthTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, target.depthTexture, 0);
+
+    const GLenum drawBuffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, drawBuffers);
+
+    glGenVertexArrays(1, &target.VAO);
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!complete) {
+        std::cout << "ERROR: Scene framebuffer not complete!" << std::endl;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return complete;
+}
+
+/*
+Bind and clear the scene target before drawing the models.
+Blending stays on for the color but not for the layer alpha,
+so the alpha texture keeps the front-most layer.
+@param target: Scene target.
+@param backgroundColor: RGB clear color.
+*/
+void postprocess::beginScene(const SceneTarget& target, const float* backgroundColor)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, target.FBO);
+    glViewport(0, 0, target.width, target.height);
+
+    const GLfloat clearColor[4] = {backgroundColor[0], backgroundColor[1], backgroundColor[2], 1.0f};
+    const GLfloat clearAlpha[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    const GLfloat clearDepth = 1.0f;
+    glClearBufferfv(GL_COLOR, 0, clearColor);
+    glClearBufferfv(GL_COLOR, 1, clearAlpha);
+    glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+
+    glEnable(GL_BLEND);
+    glDisablei(GL_BLEND, 1);
+}
+
+/*
+Draw the scene into the output framebuffer with outlines found from depth discontinuities.
+The FrameData uniform buffer must still hold the projection used for the scene.
+@param target: Scene target holding the drawn scene.
+@param shader: Screen-space outline shader.
+@param outputFBO: Framebuffer to draw into, 0 for the window.
+*/
+void postprocess::drawScreenOutline(const SceneTarget& target, const shader::Shader& shader, unsigned int outputFBO)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFBO);
+    glViewport(0, 0, target.width, target.height);
+    glDisable(GL_DEPTH_TEST);
+
+    shader.use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, target.colorTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, target.alphaTexture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, target.depthTexture);
+    glUniform1i(shader.getUniformLocation("sceneColor"), 0);
+    glUniform1i(shader.getUniformLocation("sceneAlpha"), 1);
+    glUniform1i(shader.getUniformLocation("sceneDepth"), 2);
+
+    // Full-screen triangle, positions come from gl_VertexID
+    glBindVertexArray(target.VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glActiveTexture(GL_TEXTURE0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void postprocess::cleanupSceneTarget(SceneTarget& target)
+{
+    if (target.FBO != 0) {
+        glDeleteFramebuffers(1, &target.FBO);
+        glDeleteTextures(1, &target.colorTexture);
+        glDeleteTextures(1, &target.alphaTexture);
+        glDeleteTextures(1, &target.depthTexture);
+        glDeleteVertexArrays(1, &target.VAO);
+    }
+    target = SceneTarget();
+}
+
+/*
+Internal format of the depth buffer of a framebuffer.
+@param FBO: Framebuffer object, 0 for the window.
+@return: Sized depth format, GL_NONE if the framebuffer has no depth buffer.
+*/
+GLenum postprocess::framebufferDepthFormat(GLint FBO)
+{
+    GLint previousFBO = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFBO);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+
+    // The window names its buffers differently from framebuffer objects
+    const GLenum depthAttachment = FBO == 0 ? GL_DEPTH : GL_DEPTH_ATTACHMENT;
+    const GLenum stencilAttachment = FBO == 0 ? GL_STENCIL : GL_STENCIL_ATTACHMENT;
+    GLint depthType = GL_NONE;
+    GLint stencilType = GL_NONE;
+    GLint depthBits = 0;
+    GLint stencilBits = 0;
+    GLint componentType = GL_UNSIGNED_NORMALIZED;
+    glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, depthAttachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &depthType);
+    if (depthType != GL_NONE) {
+        glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, depthAttachment, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &depthBits);
+        glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, depthAttachment, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &componentType);
+    }
+    glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, stencilAttachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &stencilType);
+    if (stencilType != GL_NONE) {
+        glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, stencilAttachment, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &stencilBits);
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, previousFBO);
+
+    if (depthBits == 0) {
+        return GL_NONE;
+    }
+    if (stencilBits > 0) {
+        return componentType == GL_FLOAT ? GL_DEPTH32F_STENCIL8 : GL_DEPTH24_STENCIL8;
+    }
+    if (componentType == GL_FLOAT) {
+        return GL_DEPTH_COMPONENT32F;
+    }
+    if (depthBits == 16) {
+        return GL_DEPTH_COMPONENT16;
+    }
+    if (depthBits == 32) {
+        return GL_DEPTH_COMPONENT32;
+    }
+    return GL_DEPTH_COMPONENT24;
+}
+
+/*
+Create the transparency target, or recreate it when the size or depth format has changed.
+@param target: Transparency target.
+@param width: Width in pixels.
+@param height: Height in pixels.
+@param depthFormat: Depth format of the output framebuffer.
+@return: false if the framebuffer is not complete.
+*/
+bool postprocess::resizeTransparencyTarget(TransparencyTarget& target, int width, int height, GLenum depthFormat)
+{
+    if (target.FBO != 0 && target.width == width && target.height == height && target.depthFormat == depthFormat) {
+        return true;
+    }
+    cleanupTransparencyTarget(target);
+    target.width = width;
+    target.height = height;
+    target.depthFormat = depthFormat;
+
+    glGenFramebuffers(1, &target.FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.FBO);
+
+    // Half floats, the weighted sums exceed 1
+    glGenTextures(1, &target.accumTexture);
+    glBindTexture(GL_TEXTURE_2D, target.accumTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.accumTexture, 0);
+
+    glGenTextures(1, &target.weightTexture);
+    glBindTexture(GL_TEXTURE_2D, target.weightTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_HALF_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, target.weightTexture, 0);
+
+    glGenRenderbuffers(1, &target.depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, depthFormat, width, height);
+    const bool hasStencil = depthFormat == GL_DEPTH24_STENCIL8 || depthFormat == GL_DEPTH32F_STENCIL8;
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, hasStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+        GL_RENDERBUFFER, target.depthRenderbuffer);
+
+    const GLenum drawBuffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, drawBuffers);
+
+    glGenVertexArrays(1, &target.VAO);
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!complete) {
+        std::cout << "ERROR: Transparency framebuffer not complete!" << std::endl;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return complete;
+}
+
+/*
+Start drawing translucent layers into the transparency target.
+The bound framebuffer and viewport are the output: the target takes their size,
+copies their opaque depth and is cleared. Depth writes are off until endTransparency.
+Both outputs share one blend function, since per-buffer blending needs OpenGL 4:
+color sums, the accumulation alpha multiplies by 1 - alpha.
+@param target: Transparency target.
+@return: false if the target could not be created, nothing is bound then.
+*/
+bool postprocess::beginTransparency(TransparencyTarget& target)
+{
+    GLint outputFBO = 0;
+    GLint viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &outputFBO);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const GLenum outputDepthFormat = framebufferDepthFormat(outputFBO);
+    const GLenum depthFormat = outputDepthFormat == GL_NONE ? GL_DEPTH_COMPONENT24 : outputDepthFormat;
+    if (!resizeTransparencyTarget(target, viewport[2], viewport[3], depthFormat)) {
+        glBindFramebuffer(GL_FRAMEBUFFER, outputFBO);
+        return false;
+    }
+    target.outputFBO = outputFBO;
+    std::copy(viewport, viewport + 4, target.outputViewport);
+    target.outputBlend1 = glIsEnabledi(GL_BLEND, 1) == GL_TRUE;
+
+    // Translucent fragments behind opaque surfaces are dropped by the copied depth
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, outputFBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target.FBO);
+    if (outputDepthFormat != GL_NONE) {
+        glBlitFramebuffer(
+            viewport[0], viewport[1], viewport[0] + viewport[2], viewport[1] + viewport[3],
+            0, 0, target.width, target.height,
+            GL_DEPTH_BUFFER_BIT, GL_NEAREST
+        );
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, target.FBO);
+    glViewport(0, 0, target.width, target.height);
+    if (outputDepthFormat == GL_NONE) {
+        const GLfloat clearDepth = 1.0f;
+        glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+    }
+
+    const GLfloat clearAccum[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    const GLfloat clearWeight[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glClearBufferfv(GL_COLOR, 0, clearAccum);
+    glClearBufferfv(GL_COLOR, 1, clearWeight);
+
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+    return true;
+}
+
+/*
+Composite the translucent layers over the output framebuffer and restore its state.
+@param target: Transparency target holding the accumulated layers.
+@param shader: Transparency composite shader.
+*/
+void postprocess::endTransparency(const TransparencyTarget& target, const shader::Shader& shader)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, target.outputFBO);
+    glViewport(target.outputViewport[0], target.outputViewport[1], target.outputViewport[2], target.outputViewport[3]);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_DEPTH_TEST);
+    // Only the color is composited, the layer alpha of a scene target stays as it is
+    glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+    shader.use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, target.accumTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, target.weightTexture);
+    glUniform1i(shader.getUniformLocation("accumulation"), 0);
+    glUniform1i(shader.getUniformLocation("weights"), 1);
+
+    glBindVertexArray(target.VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glActiveTexture(GL_TEXTURE0);
+    glColorMaski(1, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+    if (!target.outputBlend1) {
+        glDisablei(GL_BLEND, 1);
+    }
+}
+
+void postprocess::cleanupTransparencyTarget(TransparencyTarget& target)
+{
+    if (target.FBO != 0) {
+        glDeleteFramebuffers(1, &target.FBO);
+        glDeleteTextures(1, &target.accumTexture);
+        glDeleteTextures(1, &target.weightTexture);
+        glDeleteRenderbuffers(1, &target.depthRenderbuffer);
+        glDeleteVertexArrays(1, &target.VAO);
+    }
+    target = TransparencyTarget();
+}
@@ -5,6 +5,8 @@
 #include <glm/glm.hpp>
 
 #include "Model.hpp"
+#include "PostProcess.hpp"
+#include "Exporter.hpp"
 
 /*
 extern constants
@@ -27,15 +29,24 @@ extern const GLfloat GREEN[3] = {0.3f, 0.8f, 0.3f};
 extern const GLfloat ORANGE[3] = {0.8f, 0.5f, 0.0f};
 extern const GLfloat* BACKGROUND_COLOR = WHITE;  // Canvas color
 extern const bool OVERWRITE_COLOR = true;   // Whether overwriting the atomic color with the following colors
-extern const glm::vec3 COLOR_LAYER_1 = glm::vec3(RED[0], RED[1], RED[2]);  // Color settings
-extern const glm::vec3 COLOR_LAYER_2 = glm::vec3(GRAY[0], GRAY[1], GRAY[2]);
-extern const glm::vec3 COLOR_LAYER_3 = glm::vec3(GRAY[0], GRAY[1], GRAY[2]);
-extern const float ALPHA_LAYER_1 = 1.0f;  // Transparency settings, 1.0f for fully opaque
-extern const float ALPHA_LAYER_2 = 0.3f;
-extern const float ALPHA_LAYER_3 = 0.1f;
-extern const unsigned int MODEL_MODE_LAYER_1 = MODEL_MODEL_CPK;  // Molecule model settings
-extern const unsigned int MODEL_MODE_LAYER_2 = MODEL_MODEL_LINE;
-extern const unsigned int MODEL_MODE_LAYER_3 = MODEL_MODEL_LINE;
+extern const unsigned int TRANSPARENCY_MODE = TRANSPARENCY_MODE_WEIGHTED;  // TRANSPARENCY_MODE_WEIGHTED or TRANSPARENCY_MODE_BLENDED
+
+// Layer settings: color, transparency (1.0f for fully opaque) and model
+// (MODEL_MODEL_CPK, MODEL_MODEL_LINE or MODEL_MODEL_IMPOSTOR), one per molecule file in order.
+// Files past the end of the list use the last style.
+extern const model::LayerStyle LAYER_STYLES[] = {
+    {glm::vec3(RED[0], RED[1], RED[2]), 1.0f, MODEL_MODEL_CPK},
+    {glm::vec3(GRAY[0], GRAY[1], GRAY[2]), 0.3f, MODEL_MODEL_LINE},
+    {glm::vec3(GRAY[0], GRAY[1], GRAY[2]), 0.1f, MODEL_MODEL_LINE},
+};
+extern const size_t LAYER_STYLE_COUNT = sizeof(LAYER_STYLES) / sizeof(LAYER_STYLES[0]);
+
+// Periodic images drawn along a, b and c of files with an extended xyz Lattice=, see --supercell
+extern const int SUPERCELL_SIZE[3] = {1, 1, 1};
+
+// Mesh settings
+extern const bool MESH_LEVEL_OF_DETAIL = true;  // Tessellate atoms and bonds by their size on screen, false for a fixed resolution
+extern const float LOD_SEGMENT_PIXELS = 16.0f;  // Longest silhouette edge of a sphere or cylinder in pixels
 
 // Toon shader settings
 extern const float SHADOW_THRESHOLD = 0.3f;                                    // Boundary of light and shadow
@@ -47,6 +58,13 @@ extern const glm::vec3 DIRECTIONAL_LIGHT_DIR = glm::vec3(-0.5f, -0.5f, -0.5f); /
 
 // Outline shader settings
 extern const double OUTLINE_SIZE = 0.05;
+extern const unsigned int OUTLINE_MODE = OUTLINE_MODE_HULL;    // OUTLINE_MODE_HULL or OUTLINE_MODE_SCREEN
+extern const float SCREEN_OUTLINE_DEPTH_THRESHOLD = 0.3f;       // Depth step outlined by OUTLINE_MODE_SCREEN
 
 // Export settings
 extern const float HIGHR_RES_FACTOR = 4.0f; // 2x resolution
+extern const unsigned int EXPORT_IMAGE_FORMAT = IMAGE_FORMAT_PNG;   // Ctrl+S format: IMAGE_FORMAT_PNG, _PPM, _PAM, _QOI or _RGBA
+extern const int EXPORT_TILE_SIZE = 4096;   // Larger images are rendered in tiles of at most this size
+extern const int PNG_COMPRESSION_LEVEL = 6; // 0 (fastest, largest) to 9 (slowest, smallest)
+extern const int PNG_ENCODER_THREADS = 0;   // Threads compressing PNG row bands, 0 for one per core
+extern const int SEQUENCE_IMAGES_IN_FLIGHT = 3;  // Sequence images drawn but not yet handed to the encoder
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+
+
+namespace shader{
+    // Binding point of the FrameData uniform block
+    const unsigned int FRAME_DATA_BINDING = 0;
+
+    /*
+    Per-frame constants shared by every program through one uniform buffer.
+    Layout follows std140 and must match src/shaders/frame_data.glsl.
+    */
+    struct FrameData {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec3 lightPos;
+        int isDirectionalLight;
+        glm::vec3 viewPos;
+        float highlightThreshold;
+        glm::vec3 lightColor;
+        float shadowThreshold;
+        glm::vec3 shadowColor;
+        float outlineSize;
+        float bondRadius;
+        float outlineDepthThreshold;
+        float padding[2];
+    };
+    static_assert(sizeof(FrameData) == 208, "FrameData must match the std140 FrameData block");
+
+    /*
+    Linked shader program with its uniform locations resolved once at link time.
+    */
+    class Shader{
+        public:
+            Shader();
+
+            unsigned int ID;
+            // Per-draw uniforms, -1 when the program does not use them
+            GLint modelLocation;
+            GLint objectColorLocation;
+            GLint overwriteColorLocation;
+            GLint alphaLocation;
+            GLint transparentPassLocation;
+
+            bool load(const char* vertexPath, const char* fragmentPath);
+            void use(void) const;
+            void destroy(void);
+            GLint getUniformLocation(const std::string& name) const;
+        private:
+            std::map<std::string, GLint> uniformLocations;
+            void resolveUniforms(void);
+    };
+
+    /*
+    Uniform buffer holding FrameData, written once per frame.
+    */
+    class FrameUniformBuffer{
+        public:
+            FrameUniformBuffer();
+
+            unsigned int UBO;
+
+            void create(void);
+            void update(const FrameData& frameData) const;
+            void destroy(void);
+    };
+
+    bool readShaderSource(const std::string& path, std::string& source, std::set<std::string>& included);
+    unsigned int compileShader(GLenum type, const std::string& source, const char* label);
+}
+
+
+/*
+Read a shader source file.
+Lines of the form #include "file" are replaced by that file, resolved
+relative to the including shader. Each file is included at most once.
+@param path: Shader file path.
+@param source: Expanded shader source.
+@param included: Files already included into this source.
+@return: false if the file or one of its includes could not be read.
+*/
+bool shader::readShaderSource(const std::string& path, std::string& source, std::set<std::string>& included)
+{
+    if (!included.insert(path).second) {
+        return true;
+    }
+
+    std::ifstream file(path.c_str());
+    if (file.fail()) {
+        std::cout << "ERROR::SHADER::FILE_NOT_READ " << path << std::endl;
+        return false;
+    }
+
+    const std::string directory = path.substr(0, path.find_last_of('/') + 1);
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start != std::string::npos && line.compare(start, 8, "#include") == 0) {
+            size_t first = line.find('"', start);
+            size_t last = line.rfind('"');
+            if (first == std::string::npos || last <= first) {
+                std::cout << "ERROR::SHADER::BAD_INCLUDE " << path << ": " << line << std::endl;
+                return false;
+            }
+            if (!readShaderSource(directory + line.substr(first + 1, last - first - 1), source, included)) {
+                return false;
+            }
+            continue;
+        }
+        source += line;
+        source += '\n';
+    }
+    return true;
+}
+
+/*
+Compile one shader stage, printing the info log on failure.
+@param type: GL_VERTEX_SHADER or GL_FRAGMENT_SHADER.
+@param source: Expanded shader source.
+@param label: Stage name used in error messages.
+*/
+unsigned int shader::compileShader(GLenum type, const std::string& source, const char* label)
+{
+    int success;
+    char infoLog[512];
+    const char* code = source.c_str();
+
+    unsigned int id = glCreateShader(type);
+    glShaderSource(id, 1, &code, NULL);
+    glCompileShader(id);
+    glGetShaderiv(id, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(id, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::" << label << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+    return id;
+}
+
+shader::Shader::Shader() : ID(0), modelLocation(-1), objectColorLocation(-1),
+    overwriteColorLocation(-1), alphaLocation(-1), transparentPassLocation(-1) {}
+
+/*
+Compile and link a program, then resolve its uniforms.
+@param vertexPath: Vertex shader path.
+@param fragmentPath: Fragment shader path.
+@return: false if a file could not be read or the program failed to link.
+*/
+bool shader::Shader::load(const char* vertexPath, const char* fragmentPath)
+{
+    std::string vertexSource;
+    std::set<std::string> vertexIncluded;
+    if (!readShaderSource(vertexPath, vertexSource, vertexIncluded)) {
+        std::cout << "ERROR::SHADER::VERTEX::FILE_NOT_READ" << std::endl;
+        return false;
+    }
+    std::string fragmentSource;
+    std::set<std::string> fragmentIncluded;
+    if (!readShaderSource(fragmentPath, fragmentSource, fragmentIncluded)) {
+        std::cout << "ERROR::SHADER::FRAGMENT::FILE_NOT_READ" << std::endl;
+        return false;
+    }
+
+    unsigned int vertex = compileShader(GL_VERTEX_SHADER, vertexSource, "VERTEX");
+    unsigned int fragment = compileShader(GL_FRAGMENT_SHADER, fragmentSource, "FRAGMENT");
+
+    // Shader program
+    int success;
+    char infoLog[512];
+    this->ID = glCreateProgram();
+    glAttachShader(this->ID, vertex);
+    glAttachShader(this->ID, fragment);
+    glLinkProgram(this->ID);
+    glGetProgramiv(this->ID, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(this->ID, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    }
+
+    // Delete shaders
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+
+    if (!success) {
+        return false;
+    }
+    this->resolveUniforms();
+    return true;
+}
+
+/*
+Look up every active uniform once and bind the FrameData block.
+*/
+void shader::Shader::resolveUniforms(void)
+{
+    GLint uniformCount = 0;
+    glGetProgramiv(this->ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    char name[256];
+    for (GLint i = 0; i < uniformCount; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(this->ID, i, sizeof(name), &length, &size, &type, name);
+        GLint location = glGetUniformLocation(this->ID, name);
+        if (location != -1) {
+            this->uniformLocations[std::string(name, length)] = location;
+        }
+    }
+
+    this->modelLocation = this->getUniformLocation("model");
+    this->objectColorLocation = this->getUniformLocation("objectColor");
+    this->overwriteColorLocation = this->getUniformLocation("overwriteColor");
+    this->alphaLocation = this->getUniformLocation("alpha");
+    this->transparentPassLocation = this->getUniformLocation("transparentPass");
+
+    GLuint blockIndex = glGetUniformBlockIndex(this->ID, "FrameData");
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(this->ID, blockIndex, FRAME_DATA_BINDING);
+    }
+}
+
+/*
+Cached location of a uniform, -1 if the program does not use it.
+@param name: Uniform name.
+*/
+GLint shader::Shader::getUniformLocation(const std::string& name) const
+{
+    std::map<std::string, GLint>::const_iterator it = this->uniformLocations.find(name);
+    if (it == this->uniformLocations.end()) {
+        return -1;
+    }
+    return it->second;
+}
+
+void shader::Shader::use(void) const
+{
+    glUseProgram(this->ID);
+}
+
+void shader::Shader::destroy(void)
+{
+    if (this->ID != 0) {
+        glDeleteProgram(this->ID);
+        this->ID = 0;
+    }
+    this->uniformLocations.clear();
+}
+
+shader::FrameUniformBuffer::FrameUniformBuffer() : UBO(0) {}
+
+void shader::FrameUniformBuffer::create(void)
+{
+    glGenBuffers(1, &this->UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, this->UBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, this->UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void shader::FrameUniformBuffer::update(const FrameData& frameData) const
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, this->UBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &frameData);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void shader::FrameUniformBuffer::destroy(void)
+{
+    if (this->UBO != 0) {
+        glDeleteBuffers(1, &this->UBO);
+        this->UBO = 0;
+    }
+}
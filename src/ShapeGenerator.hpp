@@ -20,10 +20,12 @@ public:
      */
     static std::vector<float> generateVertices(float radius, int slices, int stacks) {
         std::vector<float> vertices;
+        vertices.reserve(getVertexCount(slices, stacks) * 6);
         const float PI = 3.14159265359f;
         
         // Generate all vertices first
         std::vector<float> allVertices;
+        allVertices.reserve(getIndexedVertexCount(slices, stacks) * 6);
         for (int i = 0; i <= stacks; ++i) {
             float stackAngle = PI / 2.0f - i * PI / stacks;
             float xy = radius * cosf(stackAngle);
@@ -66,6 +68,38 @@ public:
         return vertices;
     }
     
+    /**
+     * Generate sphere vertices and triangle indices for glDrawElements
+     * 
+     * Every grid vertex is stored once, the triangles are the same as
+     * generateVertices in the same order.
+     * 
+     * @param radius Sphere radius
+     * @param slices Number of horizontal subdivisions (longitude)
+     * @param stacks Number of vertical subdivisions (latitude)
+     * @param vertices Filled with [x,y,z,nx,ny,nz, ...], getIndexedVertexCount vertices
+     * @param indices Filled with getIndexCount 16-bit indices
+     */
+    static void generateIndexedVertices(float radius, int slices, int stacks,
+                                        std::vector<float>& vertices, std::vector<unsigned short>& indices) {
+        const float PI = 3.14159265359f;
+        vertices.clear();
+        vertices.reserve(getIndexedVertexCount(slices, stacks) * 6);
+        for (int i = 0; i <= stacks; ++i) {
+            float stackAngle = PI / 2.0f - i * PI / stacks;
+            float xy = radius * cosf(stackAngle);
+            float z = radius * sinf(stackAngle);
+            
+            for (int j = 0; j <= slices; ++j) {
+                float sliceAngle = j * 2.0f * PI / slices;
+                float x = xy * cosf(sliceAngle);
+                float y = xy * sinf(sliceAngle);
+                vertices.insert(vertices.end(), {x, y, z, x / radius, y / radius, z / radius});
+            }
+        }
+        addGridIndices(indices, slices, stacks);
+    }
+    
     /**
      * Generate sphere with texture coordinates
      * 
@@ -133,7 +167,37 @@ public:
         return slices * stacks * 6;  // 2 triangles per quad, 3 vertices per triangle
     }
     
+    /**
+     * Get the number of vertices of generateIndexedVertices, at most 65536
+     * for 16-bit indices
+     */
+    static int getIndexedVertexCount(int slices, int stacks) {
+        return (slices + 1) * (stacks + 1);
+    }
+    
+    /**
+     * Get the number of indices of generateIndexedVertices
+     */
+    static int getIndexCount(int slices, int stacks) {
+        return slices * stacks * 6;
+    }
+    
 private:
+    static void addGridIndices(std::vector<unsigned short>& indices, int slices, int stacks) {
+        indices.clear();
+        indices.reserve(getIndexCount(slices, stacks));
+        for (int i = 0; i < stacks; ++i) {
+            for (int j = 0; j < slices; ++j) {
+                unsigned short first = (unsigned short)(i * (slices + 1) + j);
+                unsigned short second = (unsigned short)(first + slices + 1);
+                indices.insert(indices.end(), {
+                    first, second, (unsigned short)(first + 1),
+                    second, (unsigned short)(second + 1), (unsigned short)(first + 1)
+                });
+            }
+        }
+    }
+    
     static void addVertex(std::vector<float>& dest, const std::vector<float>& src, int index) {
         int start = index * 6;
         dest.insert(dest.end(), src.begin() + start, src.begin() + start + 6);
@@ -165,10 +229,12 @@ public:
      */
     static std::vector<float> generateVertices(float radius, float height, int slices, int stacks) {
         std::vector<float> vertices;
+        vertices.reserve(getVertexCount(slices, stacks) * 6);
         const float PI = 3.14159265359f;
         
         // Generate all vertices first
         std::vector<float> allVertices;
+        allVertices.reserve(getIndexedVertexCount(slices, stacks) * 6);
         for (int i = 0; i <= stacks; ++i) {
             float z = height / 2.0f - i * height / stacks;
             
@@ -209,6 +275,37 @@ public:
         return vertices;
     }
     
+    /**
+     * Generate cylinder vertices and triangle indices for glDrawElements
+     * 
+     * Every grid vertex is stored once, the triangles are the same as
+     * generateVertices in the same order.
+     * 
+     * @param radius Cylinder radius
+     * @param height Cylinder height
+     * @param slices Number of horizontal subdivisions (around circumference)
+     * @param stacks Number of vertical subdivisions (along height)
+     * @param vertices Filled with [x,y,z,nx,ny,nz, ...], getIndexedVertexCount vertices
+     * @param indices Filled with getIndexCount 16-bit indices
+     */
+    static void generateIndexedVertices(float radius, float height, int slices, int stacks,
+                                        std::vector<float>& vertices, std::vector<unsigned short>& indices) {
+        const float PI = 3.14159265359f;
+        vertices.clear();
+        vertices.reserve(getIndexedVertexCount(slices, stacks) * 6);
+        for (int i = 0; i <= stacks; ++i) {
+            float z = height / 2.0f - i * height / stacks;
+            
+            for (int j = 0; j <= slices; ++j) {
+                float sliceAngle = j * 2.0f * PI / slices;
+                float nx = cosf(sliceAngle);
+                float ny = sinf(sliceAngle);
+                vertices.insert(vertices.end(), {radius * nx, radius * ny, z, nx, ny, 0.0f});
+            }
+        }
+        addGridIndices(indices, slices, stacks);
+    }
+    
     /**
      * Generate cylinder with texture coordinates
      * 
@@ -338,7 +435,37 @@ public:
         return slices * stacks * 6 + slices * 6;  // sides + top cap + bottom cap
     }
     
+    /**
+     * Get the number of vertices of generateIndexedVertices, at most 65536
+     * for 16-bit indices
+     */
+    static int getIndexedVertexCount(int slices, int stacks) {
+        return (slices + 1) * (stacks + 1);
+    }
+    
+    /**
+     * Get the number of indices of generateIndexedVertices
+     */
+    static int getIndexCount(int slices, int stacks) {
+        return slices * stacks * 6;
+    }
+    
 private:
+    static void addGridIndices(std::vector<unsigned short>& indices, int slices, int stacks) {
+        indices.clear();
+        indices.reserve(getIndexCount(slices, stacks));
+        for (int i = 0; i < stacks; ++i) {
+            for (int j = 0; j < slices; ++j) {
+                unsigned short first = (unsigned short)(i * (slices + 1) + j);
+                unsigned short second = (unsigned short)(first + slices + 1);
+                indices.insert(indices.end(), {
+                    first, second, (unsigned short)(first + 1),
+                    second, (unsigned short)(second + 1), (unsigned short)(first + 1)
+                });
+            }
+        }
+    }
+    
     static void addVertex(std::vector<float>& dest, const std::vector<float>& src, int index) {
         int start = index * 6;
         dest.insert(dest.end(), src.begin() + start, src.begin() + start + 6);
@@ -348,4 +475,34 @@ private:
         int start = index * 8;
         dest.insert(dest.end(), src.begin() + start, src.begin() + start + 8);
     }
-};
\ No newline at end of file
+};
+
+/**
+ * QuadGenerator - Creates the unit quad used by ray-cast impostors
+ * 
+ * The quad spans [-1, 1] in x and y and is meant to be drawn as a
+ * triangle strip; the vertex shader places it in front of the camera.
+ */
+class QuadGenerator {
+public:
+    /**
+     * Generate quad vertices as a flat array for glDrawArrays(GL_TRIANGLE_STRIP)
+     * 
+     * @return Vector of floats: [x,y,z,nx,ny,nz, x,y,z,nx,ny,nz, ...]
+     */
+    static std::vector<float> generateVertices() {
+        return {
+            -1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+             1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+            -1.0f,  1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+             1.0f,  1.0f, 0.0f, 0.0f, 0.0f, 1.0f
+        };
+    }
+    
+    /**
+     * Get the number of vertices that will be generated
+     */
+    static int getVertexCount() {
+        return 4;
+    }
+};
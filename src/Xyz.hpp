@@ -1,64 +1,415 @@
-#include<fstream>
+#pragma once
+
 #include<iostream>
-#include<valarray>
+#include<algorithm>
 #include<array>
+#include<vector>
 #include<string>
-#include<sstream>
+#include<cstring>
+#include<cstdlib>
+#include<cstdint>
 
 #include "Molecule.hpp"
 #include "Element.hpp"
+#include "MappedFile.hpp"
 
 
 namespace chem{
     class Xyz : public MoleculeFile{
         public:
+            Xyz();
             Xyz(const std::string& filename);
             void autoCentering(void);
         private:
             void loadFile(const std::string& filename);
     };
+
+    /*
+    Multi-frame xyz file, e.g. concatenated molecular dynamics output.
+    The file is mapped and scanned once for the byte offset of every frame,
+    after that any frame is parsed on its own without touching the others.
+    */
+    class XyzTrajectory{
+        public:
+            XyzTrajectory(const std::string& filename);
+            size_t frameCount(void) const;
+            bool loadFrame(const size_t& frame_index, MoleculeFile& frame) const;
+        private:
+            MappedFile file;
+            std::vector<size_t> frameOffsets;  // Start of each frame, then the end of the last one
+            void buildFrameIndex(const std::string& filename);
+    };
+
+    const char* parseXyzFrame(const char* begin, const char* end, MoleculeFile& molecule);
+    bool parseLattice(const char* begin, const char* end, std::array<std::array<double, 3>, 3>& lattice);
+
+    const char* skipSpaces(const char* cursor, const char* end);
+    const char* nextLine(const char* cursor, const char* end);
+    bool scanUnsigned(const char*& cursor, const char* end, size_t& value);
+    bool scanDouble(const char*& cursor, const char* end, double& value);
+}
+
+/*
+Skip spaces and tabs, stopping at the end of the line.
+*/
+const char* chem::skipSpaces(const char* cursor, const char* end){
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) {
+        cursor++;
+    }
+    return cursor;
+}
+
+/*
+Move past the next line break.
+*/
+const char* chem::nextLine(const char* cursor, const char* end){
+    while (cursor < end && *cursor != '\n') {
+        cursor++;
+    }
+    return cursor < end ? cursor + 1 : end;
 }
 
+/*
+Read a decimal integer.
+@param cursor: Read position, moved past the number on success.
+@param end: End of the buffer.
+@param value: Parsed value.
+@return: false if no digits were found or the number does not fit size_t.
+*/
+bool chem::scanUnsigned(const char*& cursor, const char* end, size_t& value){
+    const char* p = cursor;
+    value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        const size_t digit = *p - '0';
+        if (value > (SIZE_MAX - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+        p++;
+    }
+    if (p == cursor) {
+        return false;
+    }
+    cursor = p;
+    return true;
+}
+
+/*
+Read a floating point number of the form [+-]digits[.digits][(e|E)[+-]digits].
+Up to 19 significant digits are collected; when they form a mantissa of at most
+2^53 and the decimal exponent is within +-22, which covers coordinates in xyz
+files, the number is converted exactly with one multiplication or division.
+Anything else is handed to strtod.
+@param cursor: Read position, moved past the number on success.
+@param end: End of the buffer.
+@param value: Parsed value.
+@return: false if no number was found.
+*/
+bool chem::scanDouble(const char*& cursor, const char* end, double& value){
+    static const double POWERS_OF_TEN[23] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char* p = cursor;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int significantDigits = 0;
+    int exponent = 0;
+    bool anyDigit = false;
+    bool exact = true;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (significantDigits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa != 0) {significantDigits++;}
+        } else {
+            exponent++;
+            exact = false;
+        }
+        anyDigit = true;
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (significantDigits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa != 0) {significantDigits++;}
+                exponent--;
+            } else {
+                exact = false;
+            }
+            anyDigit = true;
+            p++;
+        }
+    }
+    if (!anyDigit) {
+        return false;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            negativeExponent = *q == '-';
+            q++;
+        }
+        if (q < end && *q >= '0' && *q <= '9') {
+            int explicitExponent = 0;
+            while (q < end && *q >= '0' && *q <= '9') {
+                if (explicitExponent < 100000) {
+                    explicitExponent = explicitExponent * 10 + (*q - '0');
+                }
+                q++;
+            }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+            p = q;
+        }
+    }
+
+    // Both the mantissa and the power of ten are exact doubles, so one
+    // correctly rounded operation gives the correctly rounded result
+    if (exact && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+        double result = double(mantissa);
+        result = exponent < 0 ? result / POWERS_OF_TEN[-exponent] : result * POWERS_OF_TEN[exponent];
+        value = negative ? -result : result;
+    } else {
+        char buffer[64];
+        std::string longText;
+        const char* text = buffer;
+        size_t length = p - cursor;
+        if (length < sizeof(buffer)) {
+            std::copy(cursor, p, buffer);
+            buffer[length] = '\0';
+        } else {
+            longText.assign(cursor, p);
+            text = longText.c_str();
+        }
+        value = std::strtod(text, NULL);
+    }
+    cursor = p;
+    return true;
+}
+
+chem::Xyz::Xyz(){}
+
 chem::Xyz::Xyz(const std::string& filename)
 {
     this->loadFile(filename);
 }
 
 void chem::Xyz::loadFile(const std::string& filename){
-    std::ifstream file(filename);
-    if (file.fail())
+    chem::MappedFile file;
+    if (!file.open(filename))
     {
         std::cout << filename << " file not found" << std::endl;
         return;
     }
     std::cout << filename << " file opened successfully" << std::endl;
 
-    std::string buff;
-    std::getline(file, buff);  // Atom count
-    unsigned short atom_count = std::stoi(buff);
-    this->atomNumberArray.resize(atom_count);
-    this->atomCoordArray.resize(atom_count);
+    if (chem::parseXyzFrame(file.begin(), file.end(), *this) == NULL)
+    {
+        std::cout << filename << " is not a valid xyz file, read "
+            << this->atomNumberArray.size() << " atoms" << std::endl;
+    }
+}
+
+/*
+Read the lattice vectors of an extended xyz title line,
+Lattice="ax ay az bx by bz cx cy cz" among other key=value pairs.
+@param begin: Start of the title line.
+@param end: End of the title line.
+@param lattice: Receives a, b and c.
+@return: false if the line has no complete lattice.
+*/
+bool chem::parseLattice(const char* begin, const char* end, std::array<std::array<double, 3>, 3>& lattice){
+    static const char KEY[] = "Lattice=";
+    const size_t key_length = sizeof(KEY) - 1;
+    for (const char* key = begin; key + key_length <= end; key++) {
+        if (std::memcmp(key, KEY, key_length) != 0 || (key > begin && key[-1] != ' ' && key[-1] != '\t')) {
+            continue;
+        }
+        const char* cursor = key + key_length;
+        if (cursor < end && *cursor == '"') {
+            cursor++;
+        }
+        for (int i = 0; i < 9; i++) {
+            cursor = chem::skipSpaces(cursor, end);
+            if (!chem::scanDouble(cursor, end, lattice[i / 3][i % 3])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return false;
+}
 
-    std::getline(file, buff);  // Title
+/*
+Parse one xyz frame straight from the file buffer: atom count, title and one
+line per atom. Nothing is allocated per line. An extended xyz Lattice= in the
+title makes the molecule periodic.
+@param begin: Start of the frame.
+@param end: End of the buffer.
+@param molecule: Receives the atoms. Atoms read before an error are kept.
+@return: Start of the next frame, NULL if the frame is malformed or has an unknown element.
+*/
+const char* chem::parseXyzFrame(const char* begin, const char* end, MoleculeFile& molecule){
+    const char* cursor = chem::skipSpaces(begin, end);
+    size_t atom_count = 0;
+    if (!chem::scanUnsigned(cursor, end, atom_count))
+    {
+        if (cursor < end && *cursor >= '0' && *cursor <= '9') {
+            std::cout << "xyz frame claims more atoms than a count can hold" << std::endl;
+        }
+        molecule.resize(0);
+        return NULL;
+    }
+    // Every atom line takes at least 8 bytes ("H 0 0 0" and a line break),
+    // a larger count is a corrupt header and must not be allocated
+    if (atom_count > chem::MAX_ATOM_COUNT || atom_count > (size_t)(end - cursor) / 8 + 1)
+    {
+        std::cout << "xyz frame claims " << atom_count << " atoms, more than the file can hold" << std::endl;
+        molecule.resize(0);
+        return NULL;
+    }
+    cursor = chem::nextLine(cursor, end);  // Atom count
+    const char* title = cursor;
+    cursor = chem::nextLine(cursor, end);  // Title
+    std::array<std::array<double, 3>, 3> lattice;
+    molecule.periodic = chem::parseLattice(title, cursor, lattice) && molecule.cell.set(lattice);
 
-    std::string atom_type;
-    std::array<double, 3> atom_coords = {0.0, 0.0, 0.0};
-    for (int i = 0; i < atom_count; i++)
+    molecule.resize(atom_count);
+    for (size_t i = 0; i < atom_count; i++)
     {
-        std::getline(file, buff);
-        std::stringstream buff_ss(buff);
-        buff_ss >> atom_type >> atom_coords[0] >> atom_coords[1] >> atom_coords[2];
-        this->atomNumberArray[i] = chem::getId(atom_type) + 1;
-        this->atomCoordArray[i] = atom_coords;
+        cursor = chem::skipSpaces(cursor, end);
+        const char* atom_type = cursor;
+        while (cursor < end && *cursor != ' ' && *cursor != '\t' && *cursor != '\r' && *cursor != '\n') {
+            cursor++;
+        }
+        size_t atom_type_length = cursor - atom_type;
+
+        bool valid = atom_type_length > 0;
+        for (int j = 0; j < 3 && valid; j++) {
+            double coord = 0.;
+            cursor = chem::skipSpaces(cursor, end);
+            valid = chem::scanDouble(cursor, end, coord);
+            molecule.atomCoordArrays[j][i] = (float)coord;
+        }
+        if (!valid)
+        {
+            molecule.resize(i);
+            return NULL;
+        }
+        const int element_id = chem::getId(atom_type, atom_type_length);
+        if (element_id < 0)
+        {
+            std::cout << "Unknown element \"" << std::string(atom_type, atom_type_length)
+                << "\" on atom " << i + 1 << " of an xyz frame" << std::endl;
+            molecule.resize(i);
+            return NULL;
+        }
+        molecule.atomNumberArray[i] = element_id + 1;
+        cursor = chem::nextLine(cursor, end);
     }
-    if (file.is_open()){file.close();}
+    return cursor;
 }
 
 void chem::Xyz::autoCentering(void) {
     std::array<double, 3> geom_center = this->getGeomCenter();
-    for (int i = 0; i < this->atomCoordArray.size(); i++) {
-        this->atomCoordArray[i][0] -= geom_center[0];
-        this->atomCoordArray[i][1] -= geom_center[1];
-        this->atomCoordArray[i][2] -= geom_center[2];
+    const size_t atom_count = this->size();
+    for (int k = 0; k < 3; k++) {
+        float* coords = this->atomCoordArrays[k].data();
+        const float center = (float)geom_center[k];
+        for (size_t i = 0; i < atom_count; i++) {
+            coords[i] -= center;
+        }
+    }
+}
+
+chem::XyzTrajectory::XyzTrajectory(const std::string& filename)
+{
+    if (!this->file.open(filename))
+    {
+        std::cout << filename << " file not found" << std::endl;
+        return;
+    }
+    std::cout << filename << " file opened successfully" << std::endl;
+    this->buildFrameIndex(filename);
+}
+
+/*
+Record where every frame starts. Only line breaks are looked at, the atom
+lines themselves are parsed when a frame is loaded.
+A truncated last frame is left out.
+*/
+void chem::XyzTrajectory::buildFrameIndex(const std::string& filename){
+    const char* begin = this->file.begin();
+    const char* end = this->file.end();
+    const char* cursor = begin;
+    const char* frames_end = begin;
+    while (true)
+    {
+        while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n')) {
+            cursor++;
+        }
+        if (cursor == end) {
+            break;
+        }
+
+        const char* frame_start = cursor;
+        size_t atom_count = 0;
+        if (!chem::scanUnsigned(cursor, end, atom_count) || atom_count > chem::MAX_ATOM_COUNT)
+        {
+            std::cout << filename << ": frame " << this->frameOffsets.size()
+                << " has no valid atom count, reading stops there" << std::endl;
+            break;
+        }
+
+        // Atom count line, title line and one line per atom
+        size_t lines = atom_count + 2;
+        while (lines > 0 && cursor < end)
+        {
+            const char* line_end = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+            cursor = line_end == NULL ? end : line_end + 1;
+            lines--;
+        }
+        if (lines > 0)
+        {
+            std::cout << filename << ": frame " << this->frameOffsets.size()
+                << " is truncated and was skipped" << std::endl;
+            break;
+        }
+        this->frameOffsets.push_back(frame_start - begin);
+        frames_end = cursor;
+    }
+    if (!this->frameOffsets.empty()) {
+        this->frameOffsets.push_back(frames_end - begin);
+    }
+}
+
+size_t chem::XyzTrajectory::frameCount(void) const{
+    return this->frameOffsets.empty() ? 0 : this->frameOffsets.size() - 1;
+}
+
+/*
+Parse one frame.
+@param frame_index: Frame to load, from 0 to frameCount() - 1.
+@param frame: Receives the atoms of the frame.
+@return: false if the index is out of range or the frame is malformed.
+*/
+bool chem::XyzTrajectory::loadFrame(const size_t& frame_index, MoleculeFile& frame) const{
+    if (frame_index >= this->frameCount())
+    {
+        return false;
     }
+    const char* begin = this->file.begin();
+    return chem::parseXyzFrame(
+        begin + this->frameOffsets[frame_index],
+        begin + this->frameOffsets[frame_index + 1],
+        frame
+    ) != NULL;
 }
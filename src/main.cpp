@@ -10,44 +10,53 @@
 #include <ctime>
 #include <iomanip>
 #include <sstream>
-
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
+#include <memory>
+#include <algorithm>
+#include <thread>
+#include <chrono>
 
 #include "ShapeGenerator.hpp"
 #include "Element.hpp"
 #include "Xyz.hpp"
 #include "Model.hpp"
+#include "Shader.hpp"
+#include "PostProcess.hpp"
+#include "Headless.hpp"
+#include "Exporter.hpp"
 #include "Settings.hpp"
 
+/*
+Shader programs used by the render passes, and the per-frame uniforms they share
+*/
+struct ShaderPrograms {
+    shader::Shader toon;          // Toon shading for plain meshes
+    shader::Shader outline;       // Inverted-hull outline for plain meshes
+    shader::Shader atomToon;      // Toon shading for instanced atoms
+    shader::Shader atomOutline;   // Inverted-hull outline for instanced atoms
+    shader::Shader bondToon;      // Toon shading for instanced bonds
+    shader::Shader bondOutline;   // Inverted-hull outline for instanced bonds
+    shader::Shader atomImpostorToon;      // Ray-cast sphere impostors
+    shader::Shader atomImpostorOutline;   // Far side of the expanded sphere impostors
+    shader::Shader bondImpostorToon;      // Ray-cast cylinder impostors
+    shader::Shader bondImpostorOutline;   // Far side of the expanded cylinder impostors
+    shader::Shader screenOutline;         // Screen-space outline from depth discontinuities
+    shader::Shader transparencyComposite; // Translucent layers over the opaque scene
+    shader::FrameUniformBuffer frameUniforms;   // View, projection and lighting
+};
+
 /*
 Function declaration
 */
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void processInput(GLFWwindow* window);
-unsigned int loadShader(const char* vertexPath, const char* fragmentPath);
-void exportHighResPNG(
+void exportHighResImage(
     GLFWwindow* window,
-    const std::vector<model::Model>& models, 
-    unsigned int toonShader,
-    unsigned int outlineShader
-);
-void exportHighResPNG(
-    GLFWwindow* window,
-    const std::vector<model::Model>& models_layer1, 
-    const std::vector<model::Model>& models_layer2,
-    unsigned int toonShader,
-    unsigned int outlineShader
-);
-void exportHighResPNG(
-    GLFWwindow* window,
-    const std::vector<model::Model>& models_layer1, 
-    const std::vector<model::Model>& models_layer2,
-    const std::vector<model::Model>& models_layer3,
-    unsigned int toonShader,
-    unsigned int outlineShader
+    std::vector<std::vector<model::Model>>& modelsVec,
+    const ShaderPrograms& shaders,
+    exporter::AsyncExporter& imageExporter
 );
 
 /*
@@ -59,8 +68,9 @@ glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
 glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
 glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
 
-// Export control variable
+// Export control variables
 bool exportRequested = false;
+bool exportKeysHeld = false;
 
 // Mouse and camera control variables
 bool firstMouse = true;
@@ -72,56 +82,72 @@ float yaw = -90.0f;    // Yaw is initialized to -90.0 degrees since a yaw of 0.0
 float pitch = 0.0f;
 float zoom = 1.0f;
 
+// Accumulation target of the translucent layers, resized to whatever is being drawn
+postprocess::TransparencyTarget transparencyTarget;
+
 // Model rotation variables (separate from camera)
 glm::mat4 modelRotation = glm::mat4(1.0f);
 
-void setupRenderSettings(
-    unsigned int shader,
+// Trajectory frames, the longest trajectory sets the frame count
+size_t frameCount = 1;
+size_t currentFrame = 0;
+size_t requestedFrame = 0;
+
+// Periodic images drawn along a, b and c of molecules with a lattice
+std::array<int, 3> supercellSize = {{SUPERCELL_SIZE[0], SUPERCELL_SIZE[1], SUPERCELL_SIZE[2]}};
+
+/*
+Write the per-frame uniforms shared by every program.
+Called once per frame, and again for each export.
+*/
+void updateFrameUniforms(
+    const ShaderPrograms& shaders,
     const glm::mat4& view,
-    const glm::mat4& projection,
-    const glm::mat4& model,
-    const glm::vec3& modelColor,
-    const float& alpha
+    const glm::mat4& projection
 ) {
-    glUseProgram(shader);
-    glUniformMatrix4fv(glGetUniformLocation(shader, "view"), 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-    glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, glm::value_ptr(model));
-
-    // Set lighting and color parameters for toon shader
-    glUniform3fv(glGetUniformLocation(shader, "shadowColor"), 1, glm::value_ptr(SHADOW_COLOR));
-    glUniform1f(glGetUniformLocation(shader, "highlightThreshold"), HIGHLIGHT_THRESHOLD);
-    glUniform1f(glGetUniformLocation(shader, "shadowThreshold"), SHADOW_THRESHOLD);
+    shader::FrameData frameData;
+    frameData.view = view;
+    frameData.projection = projection;
 
     // Set lighting parameters
     if (USE_DIRECTIONAL_LIGHT) {
-        glm::vec4 lightDir4 = glm::vec4(DIRECTIONAL_LIGHT_DIR, 0.0f);
-        glUniform3fv(glGetUniformLocation(shader, "lightPos"), 1, glm::value_ptr(glm::vec3(lightDir4)));
-        glUniform1i(glGetUniformLocation(shader, "isDirectionalLight"), 1);
+        frameData.lightPos = DIRECTIONAL_LIGHT_DIR;
+        frameData.isDirectionalLight = 1;
     } else {
-        glUniform3fv(glGetUniformLocation(shader, "lightPos"), 1, glm::value_ptr(POINT_LIGHT_POS));
-        glUniform1i(glGetUniformLocation(shader, "isDirectionalLight"), 0);
+        frameData.lightPos = POINT_LIGHT_POS;
+        frameData.isDirectionalLight = 0;
     }
-
-    glUniform3fv(glGetUniformLocation(shader, "viewPos"), 1, glm::value_ptr(cameraPos));
-    glUniform3f(glGetUniformLocation(shader, "lightColor"), 1.0f, 1.0f, 1.0f);
-    glUniform3fv(glGetUniformLocation(shader, "objectColor"), 1, glm::value_ptr(modelColor));
-    glUniform1f(glGetUniformLocation(shader, "alpha"), alpha);
+    frameData.viewPos = cameraPos;
+    frameData.lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
+
+    // Set toon and outline parameters
+    frameData.shadowColor = SHADOW_COLOR;
+    frameData.highlightThreshold = HIGHLIGHT_THRESHOLD;
+    frameData.shadowThreshold = SHADOW_THRESHOLD;
+    frameData.outlineSize = OUTLINE_SIZE;
+    frameData.bondRadius = BOND_RADIUS;
+    frameData.outlineDepthThreshold = SCREEN_OUTLINE_DEPTH_THRESHOLD;
+
+    shaders.frameUniforms.update(frameData);
 }
 
-void setupOutlineSettings(
-    unsigned int shader,
-    const glm::mat4& view, 
-    const glm::mat4& projection,
+/*
+Bind a program and set its per-draw uniforms from the cached locations.
+@param transparentPass: Draw into the transparency target instead of blending.
+*/
+void setupDrawSettings(
+    const shader::Shader& shader,
     const glm::mat4& model,
-    const float& alpha
+    const glm::vec3& modelColor,
+    const float& alpha,
+    bool transparentPass
 ) {
-    glUseProgram(shader);
-    glUniformMatrix4fv(glGetUniformLocation(shader, "view"), 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-    glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    glUniform1f(glGetUniformLocation(shader, "outlineSize"), OUTLINE_SIZE);
-    glUniform1f(glGetUniformLocation(shader, "alpha"), alpha);
+    shader.use();
+    glUniformMatrix4fv(shader.modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+    glUniform3fv(shader.objectColorLocation, 1, glm::value_ptr(modelColor));
+    glUniform1i(shader.overwriteColorLocation, OVERWRITE_COLOR);
+    glUniform1f(shader.alphaLocation, alpha);
+    glUniform1i(shader.transparentPassLocation, transparentPass);
 }
 
 
@@ -135,7 +161,40 @@ void printDescription() {
     std::cout << "right mouse key: rotate around camera vector" << std::endl;
     std::cout << "scroll wheel: zoom view" << std::endl;
     std::cout << "R: reset camera position" << std::endl;
-    std::cout << "Ctrl+S: export PNG image (4x resolution)" << std::endl;
+    std::cout << "Ctrl+S: export image (4x resolution)" << std::endl;
+    std::cout << "[/]: previous/next trajectory frame" << std::endl;
+    std::cout << "Page Up/Page Down: 10 frames back/forward" << std::endl;
+    std::cout << "Home/End: first/last frame" << std::endl;
+}
+
+/*
+Style of a layer. Layers past the end of LAYER_STYLES use the last style.
+@param layer: Layer index, from 0.
+*/
+const model::LayerStyle& layerStyle(size_t layer) {
+    return LAYER_STYLES[std::min(layer, LAYER_STYLE_COUNT - 1)];
+}
+
+/*
+Load one trajectory frame of a layer, centered, with the model mode of that layer.
+Past the end of a shorter trajectory its last frame is shown.
+@param trajectory: Trajectory of the layer.
+@param frameIndex: Frame to load.
+@param layer: Layer index, from 0.
+*/
+std::vector<model::Model> loadLayerFrame(
+    const chem::XyzTrajectory& trajectory,
+    size_t frameIndex,
+    size_t layer
+) {
+    chem::Xyz xyz;
+    if (trajectory.frameCount() > 0) {
+        trajectory.loadFrame(std::min(frameIndex, trajectory.frameCount() - 1), xyz);
+    }
+    xyz.autoCentering();
+    std::vector<model::Model> models = model::loadMoleculeModel(xyz, layerStyle(layer).mode);
+    model::setPeriodicImages(models, xyz, supercellSize);
+    return models;
 }
 
 void setupBackground(void) {
@@ -144,169 +203,699 @@ void setupBackground(void) {
 }
 
 /*
-Model render auxiliary function for single layers.
+Redirect the scene into the screen-space outline target.
+Does nothing with the inverted-hull outline.
+@param target: Scene target, resized to width x height.
+*/
+void beginScreenOutline(postprocess::SceneTarget& target, int width, int height) {
+    if (OUTLINE_MODE != OUTLINE_MODE_SCREEN) {
+        return;
+    }
+    postprocess::resizeSceneTarget(target, width, height);
+    postprocess::beginScene(target, BACKGROUND_COLOR);
+}
+
+/*
+Draw the scene target with its outlines into the output framebuffer.
+Does nothing with the inverted-hull outline.
+@param outputFBO: Framebuffer to draw into, 0 for the window.
+*/
+void endScreenOutline(const postprocess::SceneTarget& target, const ShaderPrograms& shaders, unsigned int outputFBO) {
+    if (OUTLINE_MODE != OUTLINE_MODE_SCREEN) {
+        return;
+    }
+    postprocess::drawScreenOutline(target, shaders.screenOutline, outputFBO);
+}
+
+/*
+Shader programs that draw a model, by model type.
+@param toonShader: Receives the toon shading program.
+@param outlineShader: Receives the inverted-hull outline program.
+*/
+void selectModelShaders(
+    const model::Model& model,
+    const ShaderPrograms& shaders,
+    const shader::Shader*& toonShader,
+    const shader::Shader*& outlineShader
+) {
+    toonShader = &shaders.toon;
+    outlineShader = &shaders.outline;
+    if (model.type == MODEL_TYPE_ATOMS) {
+        toonShader = &shaders.atomToon;
+        outlineShader = &shaders.atomOutline;
+    } else if (model.type == MODEL_TYPE_BONDS) {
+        toonShader = &shaders.bondToon;
+        outlineShader = &shaders.bondOutline;
+    } else if (model.type == MODEL_TYPE_ATOM_IMPOSTORS) {
+        toonShader = &shaders.atomImpostorToon;
+        outlineShader = &shaders.atomImpostorOutline;
+    } else if (model.type == MODEL_TYPE_BOND_IMPOSTORS) {
+        toonShader = &shaders.bondImpostorToon;
+        outlineShader = &shaders.bondImpostorOutline;
+    }
+}
+
+/*
+Draw a model once per periodic image. The images share all buffers, only the
+model matrix of the bound shader moves.
+@param transform: Model matrix of the original cell.
+*/
+void drawModelImages(const model::Model& model, const shader::Shader& shader, const glm::mat4& transform) {
+    if (model.imageOffsets.empty()) {
+        model::drawModel(model);
+        return;
+    }
+    for (const glm::vec3& offset : model.imageOffsets) {
+        const glm::mat4 image = glm::translate(transform, offset);
+        glUniformMatrix4fv(shader.modelLocation, 1, GL_FALSE, glm::value_ptr(image));
+        model::drawModel(model);
+    }
+}
+
+/*
+Render the models of one layer.
+The outline passes of all models are drawn first, then their toon passes,
+so face culling changes once per pass instead of once per model.
+@param models: Models of the layer.
+@param shaders: Shader programs.
+@param style: Color and transparency of the layer.
+@param transparentPass: Draw into the transparency target, see beginTransparency.
 */
-void modelRenderAux(
+void renderLayer(
     const std::vector<model::Model>& models,
-    unsigned int toonShader,
-    unsigned int outlineShader,
-    const glm::mat4& view,
-    const glm::mat4& projection
+    const ShaderPrograms& shaders,
+    const model::LayerStyle& style,
+    bool transparentPass
 ) {
-    const glm::vec3 color_cpk = glm::vec3(0.8f, 0.0f, 0.0f);
-    // Render all models
-    for (const struct model::Model& model : models) {
-        // Apply rotation around molecule center, then translate back to molecule center
-        glm::mat4 finalTransform = modelRotation * model.transform;
-        
-        // First pass: render outline
-        setupOutlineSettings(outlineShader, view, projection, finalTransform, ALPHA_LAYER_1);
+    const shader::Shader* toonShader;
+    const shader::Shader* outlineShader;
+
+    // First pass: render outlines, unless they are found later in screen space
+    if (OUTLINE_MODE == OUTLINE_MODE_HULL) {
         glCullFace(GL_FRONT);
-        glBindVertexArray(model.VAO);
-        glDrawArrays(GL_TRIANGLES, 0, model.vertexCount);
+        for (const model::Model& model : models) {
+            selectModelShaders(model, shaders, toonShader, outlineShader);
+            // Impostor quads always face the camera, the shaders pick the near or far hit instead
+            const bool isImpostor = (model.type == MODEL_TYPE_ATOM_IMPOSTORS) || (model.type == MODEL_TYPE_BOND_IMPOSTORS);
+            if (isImpostor) {
+                glDisable(GL_CULL_FACE);
+            }
+            // Apply rotation around molecule center, then translate back to molecule center
+            setupDrawSettings(*outlineShader, modelRotation * model.transform, model.color, style.alpha, transparentPass);
+            drawModelImages(model, *outlineShader, modelRotation * model.transform);
+            if (isImpostor) {
+                glEnable(GL_CULL_FACE);
+            }
+        }
+    }
 
-        // Second pass: render toon shading
-        if (OVERWRITE_COLOR){
-            setupRenderSettings(toonShader, view, projection, finalTransform, COLOR_LAYER_1, ALPHA_LAYER_1);
-        } else {
-            setupRenderSettings(toonShader, view, projection, finalTransform, model.color, ALPHA_LAYER_1);
+    // Second pass: render toon shading
+    glCullFace(GL_BACK);
+    for (const model::Model& model : models) {
+        selectModelShaders(model, shaders, toonShader, outlineShader);
+        const bool isImpostor = (model.type == MODEL_TYPE_ATOM_IMPOSTORS) || (model.type == MODEL_TYPE_BOND_IMPOSTORS);
+        if (isImpostor) {
+            glDisable(GL_CULL_FACE);
+        }
+        const glm::vec3& color = OVERWRITE_COLOR ? style.color : model.color;
+        setupDrawSettings(*toonShader, modelRotation * model.transform, color, style.alpha, transparentPass);
+        drawModelImages(model, *toonShader, modelRotation * model.transform);
+        if (isImpostor) {
+            glEnable(GL_CULL_FACE);
         }
-        glCullFace(GL_BACK);
-        glBindVertexArray(model.VAO);
-        glDrawArrays(GL_TRIANGLES, 0, model.vertexCount);
     }
 }
 
 /*
-Model render auxiliary function for dual layers.
+Tessellate the atoms and bonds of every layer for their size on screen.
+@param projection: Orthographic projection of the bound viewport.
 */
-void modelRenderAux(
-    const std::vector<model::Model>& models_layer1,
-    const std::vector<model::Model>& models_layer2,
-    unsigned int toonShader,
-    unsigned int outlineShader,
+void updateLevelOfDetail(std::vector<std::vector<model::Model>>& modelsVec, const glm::mat4& projection)
+{
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const float pixelsPerUnit = 0.5f * (float)viewport[3] * projection[1][1];
+    const float outlineSize = OUTLINE_MODE == OUTLINE_MODE_HULL ? (float)OUTLINE_SIZE : 0.0f;
+    for (std::vector<model::Model>& models : modelsVec) {
+        for (model::Model& model : models) {
+            model::setLevelOfDetail(model, pixelsPerUnit, outlineSize, LOD_SEGMENT_PIXELS);
+        }
+    }
+}
+
+/*
+Render every layer with its color and transparency settings.
+With TRANSPARENCY_MODE_WEIGHTED the opaque layers are drawn first, then all
+translucent layers in one unsorted pass through the transparency target,
+so the result does not depend on draw order or rotation.
+@return: false if there is nothing to render.
+*/
+bool modelRenderLayers(
+    std::vector<std::vector<model::Model>>& modelsVec,
+    const ShaderPrograms& shaders,
     const glm::mat4& view,
     const glm::mat4& projection
 ) {
-    for (const struct model::Model& model : models_layer1) {
-        // Apply rotation around molecule center, then translate back to molecule center
-        glm::mat4 finalTransform = modelRotation * model.transform;
-        
-        // First pass: render outline
-        setupOutlineSettings(outlineShader, view, projection, finalTransform, ALPHA_LAYER_1);
-        glCullFace(GL_FRONT);
-        glBindVertexArray(model.VAO);
-        glDrawArrays(GL_TRIANGLES, 0, model.vertexCount);
+    if (modelsVec.empty()) {
+        std::cout << "Error: No molecule layers to render" << std::endl;
+        return false;
+    }
+    updateFrameUniforms(shaders, view, projection);
+    if (MESH_LEVEL_OF_DETAIL) {
+        updateLevelOfDetail(modelsVec, projection);
+    }
+    if (TRANSPARENCY_MODE != TRANSPARENCY_MODE_WEIGHTED) {
+        for (size_t layer = 0; layer < modelsVec.size(); layer++) {
+            renderLayer(modelsVec[layer], shaders, layerStyle(layer), false);
+        }
+        return true;
+    }
 
-        // Second pass: render toon shading
-        if (OVERWRITE_COLOR){
-            setupRenderSettings(toonShader, view, projection, finalTransform, COLOR_LAYER_1, ALPHA_LAYER_1);
+    // Opaque layers fill the depth buffer the translucent layers are tested against
+    bool hasTranslucentLayers = false;
+    for (size_t layer = 0; layer < modelsVec.size(); layer++) {
+        if (layerStyle(layer).alpha >= 1.0f) {
+            renderLayer(modelsVec[layer], shaders, layerStyle(layer), false);
         } else {
-            setupRenderSettings(toonShader, view, projection, finalTransform, model.color, ALPHA_LAYER_1);
+            hasTranslucentLayers = true;
+        }
+    }
+    if (!hasTranslucentLayers || !postprocess::beginTransparency(transparencyTarget)) {
+        return true;
+    }
+    for (size_t layer = 0; layer < modelsVec.size(); layer++) {
+        if (layerStyle(layer).alpha < 1.0f) {
+            renderLayer(modelsVec[layer], shaders, layerStyle(layer), true);
+        }
+    }
+    postprocess::endTransparency(transparencyTarget, shaders.transparencyComposite);
+
+    // The screen-space outline also needs the depth and alpha of the translucent layers
+    if (OUTLINE_MODE == OUTLINE_MODE_SCREEN) {
+        glColorMaski(0, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        for (size_t layer = 0; layer < modelsVec.size(); layer++) {
+            if (layerStyle(layer).alpha < 1.0f) {
+                renderLayer(modelsVec[layer], shaders, layerStyle(layer), false);
+            }
         }
-        glCullFace(GL_BACK);
-        glBindVertexArray(model.VAO);
-        glDrawArrays(GL_TRIANGLES, 0, model.vertexCount);
+        glColorMaski(0, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
     }
+    return true;
+}
 
-    for (const struct model::Model& model : models_layer2) {
-        // Apply rotation around molecule center, then translate back to molecule center
-        glm::mat4 finalTransform = modelRotation * model.transform;
-        
-        // First pass: render outline
-        setupOutlineSettings(outlineShader, view, projection, finalTransform, ALPHA_LAYER_2);
-        glCullFace(GL_FRONT);
-        glBindVertexArray(model.VAO);
-        glDrawArrays(GL_TRIANGLES, 0, model.vertexCount);
+/*
+Read the bound framebuffer and save it as an image.
+@param filename: Output file name, "-" for standard output.
+@param format: Image format.
+@param width: Framebuffer width.
+@param height: Framebuffer height.
+*/
+bool saveFramebufferImage(const std::string& filename, unsigned int format, int width, int height)
+{
+    std::vector<unsigned char> pixels((size_t)width * height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
 
-        // Second pass: render toon shading
-        if (OVERWRITE_COLOR){
-            setupRenderSettings(toonShader, view, projection, finalTransform, COLOR_LAYER_2, ALPHA_LAYER_2);
-        } else {
-            setupRenderSettings(toonShader, view, projection, finalTransform, model.color, ALPHA_LAYER_2);
+    // Flip image vertically (OpenGL renders upside down)
+    std::vector<unsigned char> flippedPixels;
+    exporter::flipToRGB(pixels.data(), width, height, flippedPixels);
+
+    exporter::ImageStreamWriter image;
+    return image.open(filename, format, width, height, PNG_COMPRESSION_LEVEL, PNG_ENCODER_THREADS)
+        && image.writeRows(flippedPixels.data(), height)
+        && image.close();
+}
+
+/*
+Name for an exported image, from the current time.
+*/
+std::string exportFilename(void)
+{
+    std::time_t now = std::time(0);
+    std::tm* timeinfo = std::localtime(&now);
+    std::stringstream ss;
+    ss << "molecule_export_" 
+       << std::setfill('0') << std::setw(4) << (timeinfo->tm_year + 1900)
+       << std::setfill('0') << std::setw(2) << (timeinfo->tm_mon + 1)
+       << std::setfill('0') << std::setw(2) << timeinfo->tm_mday << "_"
+       << std::setfill('0') << std::setw(2) << timeinfo->tm_hour
+       << std::setfill('0') << std::setw(2) << timeinfo->tm_min
+       << std::setfill('0') << std::setw(2) << timeinfo->tm_sec
+       << exporter::formatExtension(EXPORT_IMAGE_FORMAT);
+    return ss.str();
+}
+
+/*
+Largest framebuffer the driver can render into, capped at EXPORT_TILE_SIZE.
+Images up to this size in both directions are rendered in one piece.
+*/
+int maxTileSize(void)
+{
+    GLint renderbufferSize = 0;
+    GLint textureSize = 0;
+    GLint viewportDims[2] = {0, 0};
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &renderbufferSize);
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &textureSize);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, viewportDims);
+    return std::min(
+        std::min(EXPORT_TILE_SIZE, (int)renderbufferSize),
+        std::min((int)textureSize, std::min((int)viewportDims[0], (int)viewportDims[1]))
+    );
+}
+
+/*
+Render an image of any size tile by tile and stream it into an image file.
+Each tile is drawn with its own slice of the orthographic projection into one
+reusable framebuffer, and finished bands of rows go straight to the encoder,
+so memory stays at one tile plus one band no matter the image size.
+With the screen-space outline, tiles overlap by the outline width so no seams show.
+@param width: Image width.
+@param height: Image height.
+@param halfWidth: Half width of the orthographic view of the whole image.
+@param halfHeight: Half height of the orthographic view of the whole image.
+@param nearPlane: Near plane of the projection.
+@param farPlane: Far plane of the projection.
+@param filename: Output file name, "-" for standard output.
+@param format: Image format.
+@return: false if rendering or writing failed.
+*/
+bool renderTiledImage(
+    std::vector<std::vector<model::Model>>& modelsVec,
+    const ShaderPrograms& shaders,
+    int width,
+    int height,
+    float halfWidth,
+    float halfHeight,
+    float nearPlane,
+    float farPlane,
+    const std::string& filename,
+    unsigned int format
+) {
+    const float pixelWidth = 2.0f * halfWidth / width;
+    const float pixelHeight = 2.0f * halfHeight / height;
+    const int tileSize = maxTileSize();
+    int margin = 0;
+    if (OUTLINE_MODE == OUTLINE_MODE_SCREEN) {
+        margin = (int)std::ceil(OUTLINE_SIZE / pixelWidth) + 2;
+    }
+    const int tileStep = tileSize - 2 * margin;
+    if (tileStep < 1) {
+        std::cout << "Error: outline is too wide for tiles of " << tileSize << " pixels" << std::endl;
+        return false;
+    }
+    // Wide images get shorter tiles so one band of rows stays within 64 MB
+    const size_t maxBandBytes = (size_t)64 << 20;
+    const int bandStep = (int)std::max((size_t)1, std::min((size_t)tileStep, maxBandBytes / ((size_t)width * 3)));
+
+    // Tile framebuffer, reused for every tile
+    unsigned int framebuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    unsigned int colorRenderbuffer;
+    glGenRenderbuffers(1, &colorRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, tileSize, tileSize);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+
+    unsigned int depthRenderbuffer;
+    glGenRenderbuffers(1, &depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, tileSize, tileSize);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+
+    bool success = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!success) {
+        std::cout << "ERROR: Framebuffer not complete!" << std::endl;
+    }
+
+    exporter::ImageStreamWriter image;
+    if (success && !image.open(filename, format, width, height, PNG_COMPRESSION_LEVEL, PNG_ENCODER_THREADS)) {
+        std::cout << "Failed to create " << filename << std::endl;
+        success = false;
+    }
+
+    glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+    postprocess::SceneTarget scene;
+    std::vector<unsigned char> band;
+    std::vector<unsigned char> tilePixels;
+    if (success) {
+        band.resize((size_t)width * std::min(bandStep, height) * 3);
+        tilePixels.resize((size_t)tileSize * tileSize * 4);
+    }
+
+    // Bands run top to bottom in image row order, tiles left to right within a band
+    for (int bandTop = 0; success && bandTop < height; bandTop += bandStep) {
+        const int bandRows = std::min(bandStep, height - bandTop);
+        for (int tileLeft = 0; success && tileLeft < width; tileLeft += tileStep) {
+            const int tileColumns = std::min(tileStep, width - tileLeft);
+            const int drawWidth = tileColumns + 2 * margin;
+            const int drawHeight = bandRows + 2 * margin;
+
+            // Slice of the full projection covering the tile and its margin
+            const float left = -halfWidth + (tileLeft - margin) * pixelWidth;
+            const float top = halfHeight - (bandTop - margin) * pixelHeight;
+            glm::mat4 projection = glm::ortho(
+                left, left + drawWidth * pixelWidth,
+                top - drawHeight * pixelHeight, top,
+                nearPlane, farPlane
+            );
+
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glViewport(0, 0, drawWidth, drawHeight);
+            setupBackground();
+            beginScreenOutline(scene, drawWidth, drawHeight);
+            success = modelRenderLayers(modelsVec, shaders, view, projection);
+            endScreenOutline(scene, shaders, framebuffer);
+
+            // Keep the tile without its margin, flipped into top-down rows
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            glReadPixels(0, 0, drawWidth, drawHeight, GL_RGBA, GL_UNSIGNED_BYTE, tilePixels.data());
+            for (int row = 0; row < bandRows; row++) {
+                const unsigned char* src = &tilePixels[((size_t)(drawHeight - 1 - margin - row) * drawWidth + margin) * 4];
+                unsigned char* dst = &band[((size_t)row * width + tileLeft) * 3];
+                for (int x = 0; x < tileColumns; x++) {
+                    dst[x * 3] = src[x * 4];
+                    dst[x * 3 + 1] = src[x * 4 + 1];
+                    dst[x * 3 + 2] = src[x * 4 + 2];
+                }
+            }
+        }
+        if (success && !image.writeRows(band.data(), bandRows)) {
+            std::cout << "Failed to write " << filename << std::endl;
+            success = false;
         }
-        glCullFace(GL_BACK);
-        glBindVertexArray(model.VAO);
-        glDrawArrays(GL_TRIANGLES, 0, model.vertexCount);
     }
+    if (success && !image.close()) {
+        std::cout << "Failed to write " << filename << std::endl;
+        success = false;
+    }
+
+    postprocess::cleanupSceneTarget(scene);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorRenderbuffer);
+    glDeleteRenderbuffers(1, &depthRenderbuffer);
+    return success;
 }
 
 /*
-Model render auxiliary function for triple layers.
+Export an image too large for one framebuffer, at HIGHR_RES_FACTOR times the window size.
+The view matches exportHighResImage.
 */
-void modelRenderAux(
-    const std::vector<model::Model>& models_layer1,
-    const std::vector<model::Model>& models_layer2,
-    const std::vector<model::Model>& models_layer3,
-    unsigned int toonShader,
-    unsigned int outlineShader,
-    const glm::mat4& view,
-    const glm::mat4& projection
+void exportTiledImage(
+    GLFWwindow* window,
+    std::vector<std::vector<model::Model>>& modelsVec,
+    const ShaderPrograms& shaders
 ) {
-    // Render all models
-    for (const struct model::Model& model : models_layer1) {
+    int currentWidth, currentHeight;
+    glfwGetFramebufferSize(window, &currentWidth, &currentHeight);
+    int highResWidth = currentWidth * HIGHR_RES_FACTOR;
+    int highResHeight = currentHeight * HIGHR_RES_FACTOR;
 
-        // Apply rotation around molecule center, then translate back to molecule center
-        glm::mat4 finalTransform = modelRotation * model.transform;
-        
-        // First pass: render outline
-        setupOutlineSettings(outlineShader, view, projection, finalTransform, ALPHA_LAYER_1);
-        glCullFace(GL_FRONT);
-        glBindVertexArray(model.VAO);
-        glDrawArrays(GL_TRIANGLES, 0, model.vertexCount);
+    std::string filename = exportFilename();
+    if (renderTiledImage(
+            modelsVec, shaders, highResWidth, highResHeight,
+            currentWidth * orthoScalingFactor / 2, currentHeight * orthoScalingFactor / 2,
+            CUE_CUTOFF_FRONT, CUE_CUTOFF_BACK, filename, EXPORT_IMAGE_FORMAT)) {
+        std::cout << "High-resolution image exported successfully: " << filename
+                  << " (" << highResWidth << "x" << highResHeight << ", tiled)" << std::endl;
+    }
+    glViewport(0, 0, currentWidth, currentHeight);
+}
 
-        // Second pass: render toon shading
-        if (OVERWRITE_COLOR){
-            setupRenderSettings(toonShader, view, projection, finalTransform, COLOR_LAYER_1, ALPHA_LAYER_1);
-        } else {
-            setupRenderSettings(toonShader, view, projection, finalTransform, model.color, ALPHA_LAYER_1);
+/*
+GLEW built for GLX reports a missing X display when the context comes from EGL.
+The entry points are still loaded, so headless mode can go on.
+*/
+bool isMissingGLXDisplay(GLenum glewStatus) {
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    return glewStatus == GLEW_ERROR_NO_GLX_DISPLAY;
+#else
+    return false;
+#endif
+}
+
+/*
+Render one frame offscreen and save it, for batch rendering without a window.
+The view covers the same height as the window, the width follows the output aspect ratio.
+@param width: Output width.
+@param height: Output height.
+@param filename: Output file name, "-" for standard output.
+@param format: Image format.
+@return: 0 on success, -1 on failure.
+*/
+int renderHeadless(
+    std::vector<std::vector<model::Model>>& modelsVec,
+    const ShaderPrograms& shaders,
+    int width,
+    int height,
+    const std::string& filename,
+    unsigned int format
+) {
+    // Too large for one framebuffer: render in tiles
+    const int tileSize = maxTileSize();
+    if (width > tileSize || height > tileSize) {
+        float halfHeight = SCR_HEIGHT * orthoScalingFactor;
+        float halfWidth = halfHeight * (float)width / (float)height;
+        if (!renderTiledImage(modelsVec, shaders, width, height, halfWidth, halfHeight,
+                CUE_CUTOFF_FRONT, CUE_CUTOFF_BACK, filename, format)) {
+            return -1;
         }
-        glCullFace(GL_BACK);
-        glBindVertexArray(model.VAO);
-        glDrawArrays(GL_TRIANGLES, 0, model.vertexCount);
+        std::cout << "Image rendered successfully: " << filename
+                  << " (" << width << "x" << height << ", tiled)" << std::endl;
+        return 0;
     }
 
-    for (const struct model::Model& model : models_layer2) {
-        // Apply rotation around molecule center, then translate back to molecule center
-        glm::mat4 finalTransform = modelRotation * model.transform;
-        
-        // First pass: render outline
-        setupOutlineSettings(outlineShader, view, projection, finalTransform, ALPHA_LAYER_1);
-        glCullFace(GL_FRONT);
-        glBindVertexArray(model.VAO);
-        glDrawArrays(GL_TRIANGLES, 0, model.vertexCount);
+    // Create framebuffer
+    unsigned int framebuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
 
-        // Second pass: render toon shading
-        if (OVERWRITE_COLOR){
-            setupRenderSettings(toonShader, view, projection, finalTransform, COLOR_LAYER_2, ALPHA_LAYER_1);
-        } else {
-            setupRenderSettings(toonShader, view, projection, finalTransform, model.color, ALPHA_LAYER_1);
+    unsigned int colorRenderbuffer;
+    glGenRenderbuffers(1, &colorRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+
+    unsigned int depthRenderbuffer;
+    glGenRenderbuffers(1, &depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+
+    int status = -1;
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR: Framebuffer not complete!" << std::endl;
+    } else {
+        glViewport(0, 0, width, height);
+        setupBackground();
+
+        glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+        float halfHeight = SCR_HEIGHT * orthoScalingFactor;
+        float halfWidth = halfHeight * (float)width / (float)height;
+        glm::mat4 projection = glm::ortho(
+            -halfWidth, halfWidth,
+            -halfHeight, halfHeight,
+            CUE_CUTOFF_FRONT, CUE_CUTOFF_BACK
+        );
+
+        postprocess::SceneTarget scene;
+        beginScreenOutline(scene, width, height);
+        bool rendered = modelRenderLayers(modelsVec, shaders, view, projection);
+        endScreenOutline(scene, shaders, framebuffer);
+        postprocess::cleanupSceneTarget(scene);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        if (rendered && saveFramebufferImage(filename, format, width, height)) {
+            std::cout << "Image rendered successfully: " << filename
+                      << " (" << width << "x" << height << ")" << std::endl;
+            status = 0;
+        } else if (rendered) {
+            std::cout << "Failed to export image " << filename << std::endl;
         }
-        glCullFace(GL_BACK);
-        glBindVertexArray(model.VAO);
-        glDrawArrays(GL_TRIANGLES, 0, model.vertexCount);
     }
 
-    for (const struct model::Model& model : models_layer3) {
-        // Apply rotation around molecule center, then translate back to molecule center
-        glm::mat4 finalTransform = modelRotation * model.transform;
-        
-        // First pass: render outline
-        setupOutlineSettings(outlineShader, view, projection, finalTransform, ALPHA_LAYER_2);
-        glCullFace(GL_FRONT);
-        glBindVertexArray(model.VAO);
-        glDrawArrays(GL_TRIANGLES, 0, model.vertexCount);
+    // Delete framebuffer objects
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorRenderbuffer);
+    glDeleteRenderbuffers(1, &depthRenderbuffer);
+    return status;
+}
 
-        // Second pass: render toon shading
-        if (OVERWRITE_COLOR){
-            setupRenderSettings(toonShader, view, projection, finalTransform, COLOR_LAYER_3, ALPHA_LAYER_2);
-        } else {
-            setupRenderSettings(toonShader, view, projection, finalTransform, model.color, ALPHA_LAYER_2);
+/*
+Parse a supercell size like 3x3x3.
+@param cells: Receives the images along a, b and c, each at least 1.
+@return: false if the text is not three positive numbers.
+*/
+bool parseSupercell(const std::string& text, std::array<int, 3>& cells)
+{
+    std::array<int, 3> parsed;
+    const char* cursor = text.c_str();
+    for (int k = 0; k < 3; k++) {
+        char* end = NULL;
+        long count = std::strtol(cursor, &end, 10);
+        if (end == cursor || count < 1 || count > 1000 || *end != (k < 2 ? 'x' : '\0')) {
+            return false;
         }
-        glCullFace(GL_BACK);
-        glBindVertexArray(model.VAO);
-        glDrawArrays(GL_TRIANGLES, 0, model.vertexCount);
+        parsed[k] = (int)count;
+        cursor = end + 1;
     }
+    cells = parsed;
+    return true;
+}
+
+/*
+File name of one image of a sequence.
+A %d in the pattern, optionally zero-padded like %04d, is replaced by the image number,
+without one the number is put before the extension. "-" stays standard output.
+@param pattern: Output name or pattern.
+@param number: Image number.
+*/
+std::string sequenceFilename(const std::string& pattern, size_t number)
+{
+    if (pattern == "-") {
+        return pattern;
+    }
+    std::string prefix = pattern;
+    std::string suffix;
+    int digits = 4;
+    size_t percent = pattern.find('%');
+    size_t conversion = percent == std::string::npos ? std::string::npos : pattern.find_first_not_of("0123456789", percent + 1);
+    if (conversion != std::string::npos && pattern[conversion] == 'd') {
+        digits = std::atoi(pattern.substr(percent + 1, conversion - percent - 1).c_str());
+        prefix = pattern.substr(0, percent);
+        suffix = pattern.substr(conversion + 1);
+    } else {
+        size_t dot = pattern.find_last_of('.');
+        size_t slash = pattern.find_last_of("/\\");
+        if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+            prefix = pattern.substr(0, dot);
+            suffix = pattern.substr(dot);
+        }
+        prefix += "_";
+    }
+    std::stringstream ss;
+    ss << prefix << std::setfill('0') << std::setw(digits) << number << suffix;
+    return ss.str();
+}
+
+/*
+Render a sequence of images offscreen: a turntable, the frames of a trajectory, or both.
+Frames are pipelined, the GPU draws the next frame while the previous one is read
+back through a pixel buffer object and the one before it is encoded on the worker thread.
+The images are numbered from 1, or all written to standard output one after the other.
+@param trajectories: Trajectory of each layer, reloaded when stepping through frames.
+@param width: Image width.
+@param height: Image height.
+@param turntableFrames: Images of one full turn about the vertical axis, 0 for no rotation.
+@param trajectory: Render every trajectory frame from the current one to the last.
+@param pattern: Output name or pattern, see sequenceFilename.
+@param format: Image format.
+@param imageExporter: Exporter that reads back and writes the images.
+@return: 0 on success, -1 on failure.
+*/
+int renderSequence(
+    std::vector<std::vector<model::Model>>& modelsVec,
+    const std::vector<std::unique_ptr<chem::XyzTrajectory>>& trajectories,
+    const ShaderPrograms& shaders,
+    int width,
+    int height,
+    size_t turntableFrames,
+    bool trajectory,
+    const std::string& pattern,
+    unsigned int format,
+    exporter::AsyncExporter& imageExporter
+) {
+    const int tileSize = maxTileSize();
+    if (width > tileSize || height > tileSize) {
+        std::cout << "Error: sequence images are limited to " << tileSize << "x" << tileSize << std::endl;
+        return -1;
+    }
+    const size_t firstFrame = currentFrame;
+    const size_t imageCount = trajectory ? frameCount - firstFrame : turntableFrames;
+    const size_t failuresBefore = imageExporter.failures();
+    const glm::mat4 startRotation = modelRotation;
+
+    // Framebuffer shared by all images, the readback of one is queued before the next is drawn
+    unsigned int framebuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    unsigned int colorRenderbuffer;
+    glGenRenderbuffers(1, &colorRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+
+    unsigned int depthRenderbuffer;
+    glGenRenderbuffers(1, &depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+
+    bool success = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!success) {
+        std::cout << "ERROR: Framebuffer not complete!" << std::endl;
+    }
+
+    glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+    float halfHeight = SCR_HEIGHT * orthoScalingFactor;
+    float halfWidth = halfHeight * (float)width / (float)height;
+    glm::mat4 projection = glm::ortho(
+        -halfWidth, halfWidth,
+        -halfHeight, halfHeight,
+        CUE_CUTOFF_FRONT, CUE_CUTOFF_BACK
+    );
+    postprocess::SceneTarget scene;
+
+    for (size_t image = 0; success && image < imageCount; image++) {
+        if (trajectory && firstFrame + image != currentFrame) {
+            currentFrame = firstFrame + image;
+            for (size_t i = 0; i < modelsVec.size(); i++) {
+                model::cleanupModels(modelsVec[i]);
+                modelsVec[i] = loadLayerFrame(*trajectories[i], currentFrame, i);
+            }
+        }
+        if (turntableFrames > 0) {
+            float angle = glm::radians(360.0f) * (float)image / (float)turntableFrames;
+            modelRotation = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f)) * startRotation;
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, width, height);
+        setupBackground();
+        beginScreenOutline(scene, width, height);
+        success = modelRenderLayers(modelsVec, shaders, view, projection);
+        endScreenOutline(scene, shaders, framebuffer);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        imageExporter.readFramebuffer(width, height, sequenceFilename(pattern, image + 1), format);
+
+        // Keep a few images in flight, so memory stays bounded when encoding is slower than drawing
+        imageExporter.poll();
+        while (imageExporter.pending() >= (size_t)std::max(1, SEQUENCE_IMAGES_IN_FLIGHT)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            imageExporter.poll();
+        }
+    }
+    imageExporter.finish();
+    success = success && imageExporter.failures() == failuresBefore;
+    modelRotation = startRotation;
+
+    postprocess::cleanupSceneTarget(scene);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorRenderbuffer);
+    glDeleteRenderbuffers(1, &depthRenderbuffer);
+    if (!success) {
+        return -1;
+    }
+    std::cout << "Sequence rendered successfully: " << imageCount << " images ("
+              << width << "x" << height << ")" << std::endl;
+    return 0;
 }
 
 int main(int argc, char* argv[])
@@ -314,70 +903,152 @@ int main(int argc, char* argv[])
     // Parse command line arguments
     // std::string filename = "./asset/C60-Ih.xyz";
     std::vector<std::string> filenameVec;
-    if (argc > 1) {
-        // Accept any length of argument
-        // and extend filenameVec
-        for (int i = 1; i < argc; i++) {
-            filenameVec.push_back(argv[i]);
-        }
-
-        std::string arg = argv[1];
-        // filename = arg;
+    bool headlessMode = false;
+    std::string outputFilename = "molecule.png";
+    std::string outputFormat;
+    size_t turntableFrames = 0;
+    bool trajectorySequence = false;
+    int outputWidth = (int)SCR_WIDTH;
+    int outputHeight = (int)SCR_HEIGHT;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
 
         // -h or --help
         if (arg == "-h" || arg == "--help") {
-            std::cout << "Usage:    " << argv[0] << " <filename>" << std::endl;
+            std::cout << "Usage:    " << argv[0] << " <filename> [<filename> ...]" << std::endl;
+            std::cout << "          " << argv[0] << " --headless [--output out.png] [--format png|ppm|pam|qoi|rgba] [--size WxH] [--frame N] [--turntable N] [--trajectory] [--supercell NxMxK] <filename> [<filename> ...]" << std::endl;
             std::cout << "Example:  " << argv[0] << " ./asset/C60-Ih.xyz" << std::endl;
+            std::cout << "Example:  " << argv[0] << " --headless --output c60.png --size 1920x1080 ./asset/C60-Ih.xyz" << std::endl;
+            std::cout << "Example:  " << argv[0] << " --headless --output - --format ppm ./asset/C60-Ih.xyz | ffmpeg -i - c60.jpg" << std::endl;
+            std::cout << "Example:  " << argv[0] << " --turntable 120 --output frames/c60_%04d.png ./asset/C60-Ih.xyz" << std::endl;
             std::cout << "Shortcut: " << argv[0] << " -h or " << argv[0] << " --help" << std::endl;
             return 0;
+        } else if (arg == "--headless") {
+            headlessMode = true;
+        } else if (arg == "--output") {
+            if (i + 1 >= argc) {
+                std::cout << "Error: --output needs a file name" << std::endl;
+                return -1;
+            }
+            outputFilename = argv[++i];
+        } else if (arg == "--format") {
+            unsigned int format;
+            if (i + 1 >= argc || !exporter::parseImageFormat(argv[i + 1], format)) {
+                std::cout << "Error: --format needs one of png, ppm, pam, qoi or rgba" << std::endl;
+                return -1;
+            }
+            outputFormat = argv[++i];
+        } else if (arg == "--size") {
+            if (i + 1 >= argc || !headless::parseSize(argv[i + 1], outputWidth, outputHeight)) {
+                std::cout << "Error: --size needs a size like 1920x1080" << std::endl;
+                return -1;
+            }
+            i++;
+        } else if (arg == "--frame") {
+            // Trajectory frame to render, counted from 1
+            char* end = NULL;
+            long frame = i + 1 < argc ? std::strtol(argv[i + 1], &end, 10) : 0;
+            if (frame < 1 || *end != '\0') {
+                std::cout << "Error: --frame needs a frame number from 1" << std::endl;
+                return -1;
+            }
+            requestedFrame = (size_t)(frame - 1);
+            i++;
+        } else if (arg == "--turntable") {
+            // Image sequence of one full turn, rendered offscreen
+            char* end = NULL;
+            long frames = i + 1 < argc ? std::strtol(argv[i + 1], &end, 10) : 0;
+            if (frames < 1 || *end != '\0') {
+                std::cout << "Error: --turntable needs a number of frames from 1" << std::endl;
+                return -1;
+            }
+            turntableFrames = (size_t)frames;
+            headlessMode = true;
+            i++;
+        } else if (arg == "--supercell") {
+            // Periodic images of files with an extended xyz Lattice=
+            if (i + 1 >= argc || !parseSupercell(argv[i + 1], supercellSize)) {
+                std::cout << "Error: --supercell needs a number of cells like 3x3x3" << std::endl;
+                return -1;
+            }
+            i++;
+        } else if (arg == "--trajectory") {
+            // Image sequence of the trajectory frames, rendered offscreen
+            trajectorySequence = true;
+            headlessMode = true;
+        } else {
+            // Accept any number of molecule files
+            filenameVec.push_back(arg);
         }
     }
 
-    // Initialize GLFW
-    if (!glfwInit()) {
-        std::cout << "Failed to initialize GLFW" << std::endl;
-        return -1;
+    // The format comes from --format, or else from the output file extension
+    unsigned int outputImageFormat = exporter::formatFromFilename(outputFilename);
+    if (!outputFormat.empty()) {
+        exporter::parseImageFormat(outputFormat, outputImageFormat);
     }
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SAMPLES, 16);  // 4x MSAA
-
-    // Create window
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Toon Shading Example", NULL, NULL);
-    if (window == NULL) {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+    if (headlessMode && outputFilename == "-") {
+        // Standard output carries the image, messages go to standard error
+        std::cout.rdbuf(std::cerr.rdbuf());
     }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
-    glfwSetMouseButtonCallback(window, [](GLFWwindow* window, int button, int action, int mods) {
-        if (button == GLFW_MOUSE_BUTTON_LEFT) {
-            if (action == GLFW_PRESS) {
-                mousePressed = true;
-                glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-            } else if (action == GLFW_RELEASE) {
-                mousePressed = false;
-                firstMouse = true;
-                glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-            }
-        } else if (button == GLFW_MOUSE_BUTTON_RIGHT) {
-            if (action == GLFW_PRESS) {
-                rightMousePressed = true;
-                glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-            } else if (action == GLFW_RELEASE) {
-                rightMousePressed = false;
-                firstMouse = true;
-                glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-            }
+
+    GLFWwindow* window = NULL;
+    headless::Context headlessContext;
+    if (headlessMode) {
+        // Surfaceless context, nothing is shown
+        if (!headless::createContext(headlessContext)) {
+            return -1;
         }
-    });
-    
+    } else {
+        // Initialize GLFW
+        if (!glfwInit()) {
+            std::cout << "Failed to initialize GLFW" << std::endl;
+            return -1;
+        }
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_SAMPLES, 16);  // 4x MSAA
+
+        // Create window
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Toon Shading Example", NULL, NULL);
+        if (window == NULL) {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetKeyCallback(window, key_callback);
+        glfwSetMouseButtonCallback(window, [](GLFWwindow* window, int button, int action, int mods) {
+            if (button == GLFW_MOUSE_BUTTON_LEFT) {
+                if (action == GLFW_PRESS) {
+                    mousePressed = true;
+                    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+                } else if (action == GLFW_RELEASE) {
+                    mousePressed = false;
+                    firstMouse = true;
+                    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+                }
+            } else if (button == GLFW_MOUSE_BUTTON_RIGHT) {
+                if (action == GLFW_PRESS) {
+                    rightMousePressed = true;
+                    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+                } else if (action == GLFW_RELEASE) {
+                    rightMousePressed = false;
+                    firstMouse = true;
+                    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+                }
+            }
+        });
+    }
+
     // Initialize GLEW
-    if (glewInit() != GLEW_OK) {
+    glewExperimental = GL_TRUE;
+    GLenum glewStatus = glewInit();
+    if (glewStatus != GLEW_OK && !(headlessMode && isMissingGLXDisplay(glewStatus))) {
         std::cout << "Failed to initialize GLEW" << std::endl;
         return -1;
     }
@@ -391,32 +1062,84 @@ int main(int argc, char* argv[])
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    printDescription();
+    if (!headlessMode) {
+        printDescription();
+    }
 
-    // Load multiple models
+    // Load multiple models, each file may hold a trajectory of many frames
     // chem::Xyz xyz = chem::Xyz(filename);
-    std::vector<std::vector<model::Model>> modelsVec;
+    std::vector<std::unique_ptr<chem::XyzTrajectory>> trajectories;
     for (int i = 0; i < filenameVec.size(); i++) {
-        chem::Xyz xyz = chem::Xyz(filenameVec[i]);
-        xyz.autoCentering();
-        if (i == 0) {
-            modelsVec.push_back(model::loadMoleculeModel(xyz, MODEL_MODE_LAYER_1));
-        } else if (i == 1) {
-            modelsVec.push_back(model::loadMoleculeModel(xyz, MODEL_MODE_LAYER_2));
-        } else if (i == 2) {
-            modelsVec.push_back(model::loadMoleculeModel(xyz, MODEL_MODE_LAYER_3));
+        trajectories.push_back(std::unique_ptr<chem::XyzTrajectory>(new chem::XyzTrajectory(filenameVec[i])));
+        frameCount = std::max(frameCount, trajectories.back()->frameCount());
+    }
+    if (requestedFrame >= frameCount) {
+        std::cout << "Warning: frame " << requestedFrame + 1 << " requested but there are only "
+                  << frameCount << " frames, showing the last one" << std::endl;
+        requestedFrame = frameCount - 1;
+    }
+    currentFrame = requestedFrame;
+    if (frameCount > 1) {
+        std::cout << frameCount << " trajectory frames, showing frame " << currentFrame + 1 << std::endl;
+    }
+    std::vector<std::vector<model::Model>> modelsVec;
+    for (size_t i = 0; i < trajectories.size(); i++) {
+        modelsVec.push_back(loadLayerFrame(*trajectories[i], currentFrame, i));
+        if (supercellSize[0] * supercellSize[1] * supercellSize[2] > 1
+            && !modelsVec.back().empty() && modelsVec.back()[0].imageOffsets.empty()) {
+            std::cout << "Warning: " << filenameVec[i] << " has no Lattice= cell, drawing it once" << std::endl;
         }
     }
 
     // Load shaders
-    unsigned int toonShader = loadShader("./src/shaders/toon.vert", "./src/shaders/toon.frag");
-    unsigned int outlineShader = loadShader("./src/shaders/outline.vert", "./src/shaders/outline.frag");
+    ShaderPrograms shaders;
+    shaders.toon.load("./src/shaders/toon.vert", "./src/shaders/toon.frag");
+    shaders.outline.load("./src/shaders/outline.vert", "./src/shaders/outline.frag");
+    shaders.atomToon.load("./src/shaders/toon_atom.vert", "./src/shaders/toon.frag");
+    shaders.atomOutline.load("./src/shaders/outline_atom.vert", "./src/shaders/outline.frag");
+    shaders.bondToon.load("./src/shaders/toon_bond.vert", "./src/shaders/toon.frag");
+    shaders.bondOutline.load("./src/shaders/outline_bond.vert", "./src/shaders/outline.frag");
+    shaders.atomImpostorToon.load("./src/shaders/impostor_atom.vert", "./src/shaders/toon_impostor_atom.frag");
+    shaders.atomImpostorOutline.load("./src/shaders/impostor_atom.vert", "./src/shaders/outline_impostor_atom.frag");
+    shaders.bondImpostorToon.load("./src/shaders/impostor_bond.vert", "./src/shaders/toon_impostor_bond.frag");
+    shaders.bondImpostorOutline.load("./src/shaders/impostor_bond.vert", "./src/shaders/outline_impostor_bond.frag");
+
+    shaders.screenOutline.load("./src/shaders/postprocess.vert", "./src/shaders/outline_screen.frag");
+    shaders.transparencyComposite.load("./src/shaders/postprocess.vert", "./src/shaders/transparency_composite.frag");
+
+    shaders.frameUniforms.create();
+    postprocess::SceneTarget windowScene;
+    exporter::AsyncExporter imageExporter(PNG_COMPRESSION_LEVEL, PNG_ENCODER_THREADS);
+
+    // Render a single image or a sequence without a window
+    int status = 0;
+    if (headlessMode && (turntableFrames > 0 || trajectorySequence)) {
+        status = renderSequence(modelsVec, trajectories, shaders, outputWidth, outputHeight,
+            turntableFrames, trajectorySequence, outputFilename, outputImageFormat, imageExporter);
+    } else if (headlessMode) {
+        status = renderHeadless(modelsVec, shaders, outputWidth, outputHeight, outputFilename, outputImageFormat);
+    }
 
     // Render loop
-    while (!glfwWindowShouldClose(window)) {
+    while (!headlessMode && !glfwWindowShouldClose(window)) {
         processInput(window);
+
+        // Load the trajectory frame picked with the frame keys
+        if (requestedFrame != currentFrame) {
+            currentFrame = requestedFrame;
+            for (size_t i = 0; i < modelsVec.size(); i++) {
+                model::cleanupModels(modelsVec[i]);
+                modelsVec[i] = loadLayerFrame(*trajectories[i], currentFrame, i);
+            }
+            std::cout << "Frame " << currentFrame + 1 << "/" << frameCount << std::endl;
+        }
+
         setupBackground();
 
+        int windowWidth, windowHeight;
+        glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
+        beginScreenOutline(windowScene, windowWidth, windowHeight);
+
         // Create transformation matrices
         glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
         glm::mat4 projection = glm::ortho(
@@ -427,195 +1150,63 @@ int main(int argc, char* argv[])
             CUE_CUTOFF_FRONT, CUE_CUTOFF_BACK
         );
 
-        if (modelsVec.size() == 1) {
-            modelRenderAux(
-                modelsVec[0],
-                toonShader, outlineShader,
-                view,
-                projection
-            );
-        } else if (modelsVec.size() == 2) {
-            modelRenderAux(
-                modelsVec[0], modelsVec[1],
-                toonShader, outlineShader,
-                view,
-                projection
-            );
-        } else if (modelsVec.size() == 3) {
-            modelRenderAux(
-                modelsVec[0], modelsVec[1], modelsVec[2],
-                toonShader, outlineShader,
-                view,
-                projection
-            );
-        } else {
-            std::cout << "Error: Invalid number of layers" << std::endl;
+        if (!modelRenderLayers(modelsVec, shaders, view, projection)) {
             return -1;
         }
+        endScreenOutline(windowScene, shaders, 0);
 
         // Check if export is requested
         if (exportRequested) {
-            if (modelsVec.size() == 1) {
-                exportHighResPNG(window, modelsVec[0], toonShader, outlineShader);
-            } else if (modelsVec.size() == 2) {
-                exportHighResPNG(window, modelsVec[0], modelsVec[1], toonShader, outlineShader);
-            } else if (modelsVec.size() == 3) {
-                exportHighResPNG(window, modelsVec[0], modelsVec[1], modelsVec[2], toonShader, outlineShader);
-            } else {
-                std::cout << "Error: Invalid number of layers" << std::endl;
-                return -1;
-            }
+            exportHighResImage(window, modelsVec, shaders, imageExporter);
             exportRequested = false;
         }
+        imageExporter.poll();
         
         // Swap buffers and poll IO events
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
     
-    // Clean up resources
+    // Clean up resources, exports still in flight are written first
+    imageExporter.finish();
     for (std::vector<model::Model>& models : modelsVec) {
         model::cleanupModels(models);
     }
-    glDeleteProgram(toonShader);
-    glDeleteProgram(outlineShader);
-    
-    glfwTerminate();
-    return 0;
-}
-
-// Export high-resolution PNG image
-void exportHighResPNG(
-    GLFWwindow* window,
-    const std::vector<model::Model>& models, 
-    unsigned int toonShader,
-    unsigned int outlineShader
-) {
-    // Get current window size
-    int currentWidth, currentHeight;
-    glfwGetFramebufferSize(window, &currentWidth, &currentHeight);
-    
-    // Calculate high-resolution size (4x resolution)
-    int highResWidth = currentWidth * HIGHR_RES_FACTOR;
-    int highResHeight = currentHeight * HIGHR_RES_FACTOR;
-    
-    // Create framebuffer for high-resolution rendering
-    unsigned int framebuffer;
-    glGenFramebuffers(1, &framebuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-    
-    // Create color texture
-    unsigned int colorTexture;
-    glGenTextures(1, &colorTexture);
-    glBindTexture(GL_TEXTURE_2D, colorTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, highResWidth, highResHeight, 0, 
-                 GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 
-                          GL_TEXTURE_2D, colorTexture, 0);
-    
-    // Create depth renderbuffer
-    unsigned int depthRenderbuffer;
-    glGenRenderbuffers(1, &depthRenderbuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 
-                         highResWidth, highResHeight);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, 
-                             GL_RENDERBUFFER, depthRenderbuffer);
-    
-    // Check framebuffer completeness
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cout << "ERROR: Framebuffer not complete!" << std::endl;
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glDeleteFramebuffers(1, &framebuffer);
-        glDeleteTextures(1, &colorTexture);
-        glDeleteRenderbuffers(1, &depthRenderbuffer);
-        return;
-    }
-    
-    // Set viewport for high-resolution rendering
-    glViewport(0, 0, highResWidth, highResHeight);
-    
-    // Clear framebuffer
-    glClearColor(BACKGROUND_COLOR[0], BACKGROUND_COLOR[1], BACKGROUND_COLOR[2], 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    
-    // Create transformation matrices for high-resolution rendering
-    glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-    glm::mat4 projection = glm::ortho(
-        -(float)highResWidth * orthoScalingFactor / HIGHR_RES_FACTOR / 2,  // Scale down by 4x to match original view
-        (float)highResWidth * orthoScalingFactor / HIGHR_RES_FACTOR / 2,
-        -(float)highResHeight * orthoScalingFactor / HIGHR_RES_FACTOR / 2,
-        (float)highResHeight * orthoScalingFactor / HIGHR_RES_FACTOR / 2,
-        -100.0f, 100.0f
-    );
-    
-    // Render all models at high resolution
-    modelRenderAux(
-        models,
-        toonShader, outlineShader,
-        view, projection
-    );
-
-    // Read pixels from framebuffer
-    unsigned char* pixels = new unsigned char[highResWidth * highResHeight * 3];
-    glReadPixels(0, 0, highResWidth, highResHeight, GL_RGB, GL_UNSIGNED_BYTE, pixels);
-    
-    // Flip image vertically (OpenGL renders upside down)
-    unsigned char* flippedPixels = new unsigned char[highResWidth * highResHeight * 3];
-    for (int y = 0; y < highResHeight; y++) {
-        for (int x = 0; x < highResWidth; x++) {
-            int srcIndex = (y * highResWidth + x) * 3;
-            int dstIndex = ((highResHeight - 1 - y) * highResWidth + x) * 3;
-            flippedPixels[dstIndex] = pixels[srcIndex];
-            flippedPixels[dstIndex + 1] = pixels[srcIndex + 1];
-            flippedPixels[dstIndex + 2] = pixels[srcIndex + 2];
-        }
-    }
-    
-    // Generate filename with timestamp
-    std::time_t now = std::time(0);
-    std::tm* timeinfo = std::localtime(&now);
-    std::stringstream ss;
-    ss << "molecule_export_" 
-       << std::setfill('0') << std::setw(4) << (timeinfo->tm_year + 1900)
-       << std::setfill('0') << std::setw(2) << (timeinfo->tm_mon + 1)
-       << std::setfill('0') << std::setw(2) << timeinfo->tm_mday << "_"
-       << std::setfill('0') << std::setw(2) << timeinfo->tm_hour
-       << std::setfill('0') << std::setw(2) << timeinfo->tm_min
-       << std::setfill('0') << std::setw(2) << timeinfo->tm_sec << ".png";
-    std::string filename = ss.str();
+    model::cleanupMeshCache();
+    shaders.toon.destroy();
+    shaders.outline.destroy();
+    shaders.atomToon.destroy();
+    shaders.atomOutline.destroy();
+    shaders.bondToon.destroy();
+    shaders.bondOutline.destroy();
+    shaders.atomImpostorToon.destroy();
+    shaders.atomImpostorOutline.destroy();
+    shaders.bondImpostorToon.destroy();
+    shaders.bondImpostorOutline.destroy();
+    shaders.screenOutline.destroy();
+    shaders.transparencyComposite.destroy();
+    postprocess::cleanupSceneTarget(windowScene);
+    postprocess::cleanupTransparencyTarget(transparencyTarget);
+    shaders.frameUniforms.destroy();
     
-    // Save PNG image
-    if (stbi_write_png(filename.c_str(), highResWidth, highResHeight, 3, flippedPixels, highResWidth * 3)) {
-        std::cout << "High-resolution PNG exported successfully: " << filename 
-                  << " (" << highResWidth << "x" << highResHeight << ")" << std::endl;
+    if (headlessMode) {
+        headless::destroyContext(headlessContext);
     } else {
-        std::cout << "Failed to export PNG image" << std::endl;
+        glfwTerminate();
     }
-    
-    // Clean up
-    delete[] pixels;
-    delete[] flippedPixels;
-    
-    // Restore original framebuffer and viewport
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, currentWidth, currentHeight);
-    
-    // Delete framebuffer objects
-    glDeleteFramebuffers(1, &framebuffer);
-    glDeleteTextures(1, &colorTexture);
-    glDeleteRenderbuffers(1, &depthRenderbuffer);
+    return status;
 }
 
-// Export high-resolution PNG image
-void exportHighResPNG(
+/*
+Export an image of all layers at HIGHR_RES_FACTOR times the window size.
+The image is read back without waiting and written by the exporter in the background,
+images too large for one framebuffer are rendered in tiles instead.
+*/
+void exportHighResImage(
     GLFWwindow* window,
-    const std::vector<model::Model>& models_layer1, 
-    const std::vector<model::Model>& models_layer2,
-    unsigned int toonShader,
-    unsigned int outlineShader
+    std::vector<std::vector<model::Model>>& modelsVec,
+    const ShaderPrograms& shaders,
+    exporter::AsyncExporter& imageExporter
 ) {
     // Get current window size
     int currentWidth, currentHeight;
@@ -625,6 +1216,12 @@ void exportHighResPNG(
     int highResWidth = currentWidth * HIGHR_RES_FACTOR;
     int highResHeight = currentHeight * HIGHR_RES_FACTOR;
 
+    const int tileSize = maxTileSize();
+    if (highResWidth > tileSize || highResHeight > tileSize) {
+        exportTiledImage(window, modelsVec, shaders);
+        return;
+    }
+
     // Create framebuffer for high-resolution rendering
     unsigned int framebuffer;
     glGenFramebuffers(1, &framebuffer);
@@ -639,7 +1236,7 @@ void exportHighResPNG(
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
 
-    // Create depth render buffer
+    // Create depth renderbuffer
     unsigned int depthRenderbuffer;
     glGenRenderbuffers(1, &depthRenderbuffer);
     glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
@@ -658,11 +1255,8 @@ void exportHighResPNG(
 
     // Set viewport for high-resolution rendering
     glViewport(0, 0, highResWidth, highResHeight);
+    setupBackground();
 
-    // Clear framebuffer
-    glClearColor(BACKGROUND_COLOR[0], BACKGROUND_COLOR[1], BACKGROUND_COLOR[2], 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    
     // Create transformation matrices for high-resolution rendering
     glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
     glm::mat4 projection = glm::ortho(
@@ -673,203 +1267,66 @@ void exportHighResPNG(
         CUE_CUTOFF_FRONT, CUE_CUTOFF_BACK
     );
 
-    // Render all models at high resolution
-    modelRenderAux(
-        models_layer1, models_layer2,
-        toonShader, outlineShader,
-        view, projection
-    );
+    // Render all layers at high resolution
+    postprocess::SceneTarget exportScene;
+    beginScreenOutline(exportScene, highResWidth, highResHeight);
+    bool rendered = modelRenderLayers(modelsVec, shaders, view, projection);
+    endScreenOutline(exportScene, shaders, framebuffer);
+    postprocess::cleanupSceneTarget(exportScene);
 
-    // Read pixels from framebuffer
-    unsigned char* pixels = new unsigned char[highResWidth * highResHeight * 3];
-    glReadPixels(0, 0, highResWidth, highResHeight, GL_RGB, GL_UNSIGNED_BYTE, pixels);
-    
-    // Flip image vertically (OpenGL renders upside down)
-    unsigned char* flippedPixels = new unsigned char[highResWidth * highResHeight * 3];
-    for (int y = 0; y < highResHeight; y++) {
-        for (int x = 0; x < highResWidth; x++) {
-            int srcIndex = (y * highResWidth + x) * 3;
-            int dstIndex = ((highResHeight - 1 - y) * highResWidth + x) * 3;
-            flippedPixels[dstIndex] = pixels[srcIndex];
-            flippedPixels[dstIndex + 1] = pixels[srcIndex + 1];
-            flippedPixels[dstIndex + 2] = pixels[srcIndex + 2];
-        }
+    // Read back without waiting, the exporter writes the image in the background
+    if (rendered) {
+        imageExporter.readFramebuffer(highResWidth, highResHeight, exportFilename(), EXPORT_IMAGE_FORMAT);
     }
-    
-    // Generate filename with timestamp
-    std::time_t now = std::time(0);
-    std::tm* timeinfo = std::localtime(&now);
-    std::stringstream ss;
-    ss << "molecule_export_" 
-       << std::setfill('0') << std::setw(4) << (timeinfo->tm_year + 1900)
-       << std::setfill('0') << std::setw(2) << (timeinfo->tm_mon + 1)
-       << std::setfill('0') << std::setw(2) << timeinfo->tm_mday << "_"
-       << std::setfill('0') << std::setw(2) << timeinfo->tm_hour
-       << std::setfill('0') << std::setw(2) << timeinfo->tm_min
-       << std::setfill('0') << std::setw(2) << timeinfo->tm_sec << ".png";
-    std::string filename = ss.str();
 
-    // Save PNG image
-    if (stbi_write_png(filename.c_str(), highResWidth, highResHeight, 3, flippedPixels, highResWidth * 3)) {
-        std::cout << "High-resolution PNG exported successfully: " << filename 
-                  << " (" << highResWidth << "x" << highResHeight << ")" << std::endl;
-    } else {
-        std::cout << "Failed to export PNG image" << std::endl;
-    }
-    
-    // Clean up
-    delete[] pixels;
-    delete[] flippedPixels;
-    
     // Restore original framebuffer and viewport
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glViewport(0, 0, currentWidth, currentHeight);
-    
+
     // Delete framebuffer objects
     glDeleteFramebuffers(1, &framebuffer);
     glDeleteTextures(1, &colorTexture);
     glDeleteRenderbuffers(1, &depthRenderbuffer);
 }
 
-// Export high-resolution PNG image
-void exportHighResPNG(
-    GLFWwindow* window,
-    const std::vector<model::Model>& models_layer1, 
-    const std::vector<model::Model>& models_layer2,
-    const std::vector<model::Model>& models_layer3,
-    unsigned int toonShader,
-    unsigned int outlineShader
-) {
-    // Get current window size
-    int currentWidth, currentHeight;
-    glfwGetFramebufferSize(window, &currentWidth, &currentHeight);
-    
-    // Calculate high-resolution size (4x resolution)
-    int highResWidth = currentWidth * HIGHR_RES_FACTOR;
-    int highResHeight = currentHeight * HIGHR_RES_FACTOR;
-    
-    // Create framebuffer for high-resolution rendering
-    unsigned int framebuffer;
-    glGenFramebuffers(1, &framebuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-    
-    // Create color texture
-    unsigned int colorTexture;
-    glGenTextures(1, &colorTexture);
-    glBindTexture(GL_TEXTURE_2D, colorTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, highResWidth, highResHeight, 0, 
-                 GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 
-                          GL_TEXTURE_2D, colorTexture, 0);
-    
-    // Create depth renderbuffer
-    unsigned int depthRenderbuffer;
-    glGenRenderbuffers(1, &depthRenderbuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 
-                         highResWidth, highResHeight);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, 
-                             GL_RENDERBUFFER, depthRenderbuffer);
-    
-    // Check framebuffer completeness
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cout << "ERROR: Framebuffer not complete!" << std::endl;
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glDeleteFramebuffers(1, &framebuffer);
-        glDeleteTextures(1, &colorTexture);
-        glDeleteRenderbuffers(1, &depthRenderbuffer);
+// Process input
+/*
+Step through trajectory frames. Holding a key repeats the step.
+*/
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    if (action != GLFW_PRESS && action != GLFW_REPEAT) {
         return;
     }
-    
-    // Set viewport for high-resolution rendering
-    glViewport(0, 0, highResWidth, highResHeight);
-    
-    // Clear framebuffer
-    glClearColor(BACKGROUND_COLOR[0], BACKGROUND_COLOR[1], BACKGROUND_COLOR[2], 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    
-    // Create transformation matrices for high-resolution rendering
-    glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-    glm::mat4 projection = glm::ortho(
-        -(float)highResWidth * orthoScalingFactor / HIGHR_RES_FACTOR / 2,  // Scale down by 4x to match original view
-        (float)highResWidth * orthoScalingFactor / HIGHR_RES_FACTOR / 2,
-        -(float)highResHeight * orthoScalingFactor / HIGHR_RES_FACTOR / 2,
-        (float)highResHeight * orthoScalingFactor / HIGHR_RES_FACTOR / 2,
-        -100.0f, 100.0f
-    );
-
-    // Render all models at high resolution
-    modelRenderAux(
-        models_layer1, models_layer2, models_layer3,
-        toonShader, outlineShader,
-        view, projection
-    );
-
-    // Read pixels from framebuffer
-    unsigned char* pixels = new unsigned char[highResWidth * highResHeight * 3];
-    glReadPixels(0, 0, highResWidth, highResHeight, GL_RGB, GL_UNSIGNED_BYTE, pixels);
-    
-    // Flip image vertically (OpenGL renders upside down)
-    unsigned char* flippedPixels = new unsigned char[highResWidth * highResHeight * 3];
-    for (int y = 0; y < highResHeight; y++) {
-        for (int x = 0; x < highResWidth; x++) {
-            int srcIndex = (y * highResWidth + x) * 3;
-            int dstIndex = ((highResHeight - 1 - y) * highResWidth + x) * 3;
-            flippedPixels[dstIndex] = pixels[srcIndex];
-            flippedPixels[dstIndex + 1] = pixels[srcIndex + 1];
-            flippedPixels[dstIndex + 2] = pixels[srcIndex + 2];
-        }
-    }
-    
-    // Generate filename with timestamp
-    std::time_t now = std::time(0);
-    std::tm* timeinfo = std::localtime(&now);
-    std::stringstream ss;
-    ss << "molecule_export_" 
-       << std::setfill('0') << std::setw(4) << (timeinfo->tm_year + 1900)
-       << std::setfill('0') << std::setw(2) << (timeinfo->tm_mon + 1)
-       << std::setfill('0') << std::setw(2) << timeinfo->tm_mday << "_"
-       << std::setfill('0') << std::setw(2) << timeinfo->tm_hour
-       << std::setfill('0') << std::setw(2) << timeinfo->tm_min
-       << std::setfill('0') << std::setw(2) << timeinfo->tm_sec << ".png";
-    std::string filename = ss.str();
-    
-    // Save PNG image
-    if (stbi_write_png(filename.c_str(), highResWidth, highResHeight, 3, flippedPixels, highResWidth * 3)) {
-        std::cout << "High-resolution PNG exported successfully: " << filename 
-                  << " (" << highResWidth << "x" << highResHeight << ")" << std::endl;
-    } else {
-        std::cout << "Failed to export PNG image" << std::endl;
+    const size_t lastFrame = frameCount - 1;
+    if (key == GLFW_KEY_RIGHT_BRACKET) {
+        requestedFrame = std::min(requestedFrame + 1, lastFrame);
+    } else if (key == GLFW_KEY_LEFT_BRACKET) {
+        requestedFrame = requestedFrame > 0 ? requestedFrame - 1 : 0;
+    } else if (key == GLFW_KEY_PAGE_DOWN) {
+        requestedFrame = std::min(requestedFrame + 10, lastFrame);
+    } else if (key == GLFW_KEY_PAGE_UP) {
+        requestedFrame = requestedFrame > 10 ? requestedFrame - 10 : 0;
+    } else if (key == GLFW_KEY_HOME) {
+        requestedFrame = 0;
+    } else if (key == GLFW_KEY_END) {
+        requestedFrame = lastFrame;
     }
-    
-    // Clean up
-    delete[] pixels;
-    delete[] flippedPixels;
-    
-    // Restore original framebuffer and viewport
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, currentWidth, currentHeight);
-    
-    // Delete framebuffer objects
-    glDeleteFramebuffers(1, &framebuffer);
-    glDeleteTextures(1, &colorTexture);
-    glDeleteRenderbuffers(1, &depthRenderbuffer);
 }
 
-// Process input
 void processInput(GLFWwindow* window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
     
-    // Export PNG with Ctrl+S
-    if ((glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS || 
+    // Export an image with Ctrl+S, once per press since exports no longer block the loop
+    bool exportKeysPressed = (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS || 
          glfwGetKey(window, GLFW_KEY_RIGHT_CONTROL) == GLFW_PRESS) &&
-        glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+        glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
+    if (exportKeysPressed && !exportKeysHeld) {
         exportRequested = true;
     }
+    exportKeysHeld = exportKeysPressed;
     
     // Camera movement with WASD keys
     float cameraSpeed = 0.05f;
@@ -907,87 +1364,6 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     glViewport(0, 0, width, height);
 }
 
-unsigned int loadShader(const char* vertexPath, const char* fragmentPath)
-{
-    // Read vertex shader
-    FILE* file = fopen(vertexPath, "r");
-    if (!file) {
-        std::cout << "ERROR::SHADER::VERTEX::FILE_NOT_READ" << std::endl;
-        return 0;
-    }
-    
-    fseek(file, 0, SEEK_END);
-    long length = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    
-    char* vertexCode = new char[length + 1];
-    fread(vertexCode, 1, length, file);
-    vertexCode[length] = '\0';
-    fclose(file);
-    
-    // Read fragment shader
-    file = fopen(fragmentPath, "r");
-    if (!file) {
-        std::cout << "ERROR::SHADER::FRAGMENT::FILE_NOT_READ" << std::endl;
-        delete[] vertexCode;
-        return 0;
-    }
-    
-    fseek(file, 0, SEEK_END);
-    length = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    
-    char* fragmentCode = new char[length + 1];
-    fread(fragmentCode, 1, length, file);
-    fragmentCode[length] = '\0';
-    fclose(file);
-    
-    // Compile shaders
-    unsigned int vertex, fragment;
-    int success;
-    char infoLog[512];
-    
-    // Vertex shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vertexCode, NULL);
-    glCompileShader(vertex);
-    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-    
-    // Fragment shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fragmentCode, NULL);
-    glCompileShader(fragment);
-    glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-    
-    // Shader program
-    unsigned int id = glCreateProgram();
-    glAttachShader(id, vertex);
-    glAttachShader(id, fragment);
-    glLinkProgram(id);
-    glGetProgramiv(id, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(id, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-    
-    // Delete shaders
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
-    
-    delete[] vertexCode;
-    delete[] fragmentCode;
-    
-    return id;
-}
-
 // Mouse movement callback for model rotation (not camera rotation)
 void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 {
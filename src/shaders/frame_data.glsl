@@ -0,0 +1,17 @@
+// Per-frame constants, written once per frame into one uniform buffer.
+// Layout must match shader::FrameData in src/Shader.hpp.
+
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightPos;                  // Position of the light
+    bool isDirectionalLight;        // True for directional light, False for point light
+    vec3 viewPos;                   // Position of the camera
+    float highlightThreshold;       // Top highlight threshold; 1 for no highlight.
+    vec3 lightColor;                // Color of the light
+    float shadowThreshold;          // Boundary of light and shadow
+    vec3 shadowColor;               // color < shadowThreshold, use shadowColor;
+    float outlineSize;              // Outline size
+    float bondRadius;               // Radius of the bond
+    float outlineDepthThreshold;    // Depth step drawn as a screen-space outline
+};
@@ -0,0 +1,55 @@
+// Ray casting helpers shared by the impostor shaders.
+// The projection is orthographic, so every ray runs along the camera front vector.
+
+// Camera front vector in world space, taken from the view matrix
+vec3 cameraFront(mat4 view)
+{
+    return -vec3(view[0][2], view[1][2], view[2][2]);
+}
+
+// Depth buffer value of a world-space point
+float fragDepth(vec3 worldPos, mat4 view, mat4 projection)
+{
+    vec4 clipPos = projection * view * vec4(worldPos, 1.0);
+    float ndcDepth = clipPos.z / clipPos.w;
+    return (gl_DepthRange.diff * ndcDepth + gl_DepthRange.near + gl_DepthRange.far) * 0.5;
+}
+
+// Ray parameter of the front (farSide = false) or back (farSide = true) sphere hit, false on miss
+bool raySphere(vec3 rayOrigin, vec3 rayDir, vec3 center, float radius, bool farSide, out float t)
+{
+    vec3 oc = rayOrigin - center;
+    float b = dot(oc, rayDir);
+    float h = b * b - dot(oc, oc) + radius * radius;
+    if (h < 0.0) {
+        return false;
+    }
+    h = sqrt(h);
+    t = farSide ? -b + h : -b - h;
+    return true;
+}
+
+// Ray parameter of the front or back hit on an open cylinder from start to end, false on miss.
+// Like the tessellated bond, the tube has no caps and its inside is never drawn.
+bool rayCylinder(vec3 rayOrigin, vec3 rayDir, vec3 start, vec3 end, float radius, bool farSide, out float t)
+{
+    vec3 ba = end - start;
+    vec3 oc = rayOrigin - start;
+    float baba = dot(ba, ba);
+    float bard = dot(ba, rayDir);
+    float baoc = dot(ba, oc);
+    float k2 = baba - bard * bard;
+    if (k2 < 1e-6 * baba) {
+        return false;   // Looking straight down the axis
+    }
+    float k1 = baba * dot(oc, rayDir) - baoc * bard;
+    float k0 = baba * dot(oc, oc) - baoc * baoc - radius * radius * baba;
+    float h = k1 * k1 - k2 * k0;
+    if (h < 0.0) {
+        return false;
+    }
+    h = sqrt(h);
+    t = farSide ? (-k1 + h) / k2 : (-k1 - h) / k2;
+    float y = baoc + t * bard;
+    return (y >= 0.0) && (y <= baba);
+}
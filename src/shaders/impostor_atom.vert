@@ -0,0 +1,36 @@
+#version 330 core
+
+layout(location = 0) in vec3 aPos;      // Unit quad corner in [-1, 1]
+layout(location = 2) in float aCenterX;  // Per-instance atom position, one array per axis
+layout(location = 5) in float aCenterY;
+layout(location = 6) in float aCenterZ;
+layout(location = 3) in float aRadius;  // Per-instance atom radius
+layout(location = 4) in vec3 aColor;    // Per-instance atom color
+
+out vec3 FragPos;
+flat out vec3 Center;
+flat out float Radius;
+flat out vec3 ObjectColor;
+
+uniform mat4 model;
+uniform vec3 objectColor;       // Color of the layer
+uniform bool overwriteColor;    // True to use objectColor instead of the atom color
+
+#include "frame_data.glsl"
+
+void main()
+{
+    vec3 center = vec3(aCenterX, aCenterY, aCenterZ);
+
+    // Camera right and up vectors in world space
+    vec3 right = vec3(view[0][0], view[1][0], view[2][0]);
+    vec3 up = vec3(view[0][1], view[1][1], view[2][1]);
+
+    Center = vec3(model * vec4(center, 1.0));
+    Radius = aRadius;
+    ObjectColor = overwriteColor ? objectColor : aColor;
+
+    // Screen-aligned quad just covering the sphere and its outline
+    FragPos = Center + (right * aPos.x + up * aPos.y) * (Radius + outlineSize);
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,37 @@
+#version 330 core
+
+layout(location = 0) in vec3 aPos;      // Unit quad corner, x across and y along the bond
+layout(location = 2) in vec3 aStart;    // Per-instance bond start point
+layout(location = 3) in vec3 aEnd;      // Per-instance bond end point
+
+out vec3 FragPos;
+flat out vec3 Start;
+flat out vec3 End;
+flat out float Radius;
+flat out vec3 ObjectColor;
+
+uniform mat4 model;
+uniform vec3 objectColor;       // Color of the bond
+
+#include "frame_data.glsl"
+
+void main()
+{
+    vec3 front = -vec3(view[0][2], view[1][2], view[2][2]);
+    vec3 up = vec3(view[0][1], view[1][1], view[2][1]);
+
+    Start = vec3(model * vec4(aStart, 1.0));
+    End = vec3(model * vec4(aEnd, 1.0));
+    Radius = bondRadius;
+    ObjectColor = objectColor;
+
+    // Bond direction projected on the screen plane
+    vec3 along = (End - Start) - dot(End - Start, front) * front;
+    along = length(along) > 1e-6 ? normalize(along) : up;
+    vec3 across = cross(front, along);
+
+    // Quad from start to end, padded by the radius and outline on every side
+    vec3 base = aPos.y < 0.0 ? Start : End;
+    FragPos = base + (along * aPos.y + across * aPos.x) * (Radius + outlineSize);
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -1,11 +1,14 @@
 #version 330 core
 
-out vec4 FragColor;
+layout(location = 0) out vec4 FragColor;
+layout(location = 1) out float LayerAlpha;
 
 uniform float alpha;                    // Transparency of the outline
 
+#include "transparency.glsl"
+
 void main()
 {
     // Black outline with transparency
-    FragColor = vec4(0.0, 0.0, 0.0, alpha);
+    writeLayerColor(vec3(0.0), alpha, gl_FragCoord.z, FragColor, LayerAlpha);
 }
\ No newline at end of file
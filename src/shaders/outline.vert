@@ -4,9 +4,8 @@ layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform float outlineSize;      // Outline size
+
+#include "frame_data.glsl"
 
 void main()
 {
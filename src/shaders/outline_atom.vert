@@ -0,0 +1,21 @@
+#version 330 core
+
+layout(location = 0) in vec3 aPos;      // Unit sphere vertex
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in float aCenterX;  // Per-instance atom position, one array per axis
+layout(location = 5) in float aCenterY;
+layout(location = 6) in float aCenterZ;
+layout(location = 3) in float aRadius;  // Per-instance atom radius
+
+uniform mat4 model;
+
+#include "frame_data.glsl"
+
+void main()
+{
+    vec3 center = vec3(aCenterX, aCenterY, aCenterZ);
+
+    // Scale the unit sphere to the atom, then expand along the normal direction
+    vec3 pos = center + aPos * aRadius + aNormal * outlineSize;
+    gl_Position = projection * view * model * vec4(pos, 1.0);
+}
@@ -0,0 +1,26 @@
+#version 330 core
+
+layout(location = 0) in vec3 aPos;      // Unit cylinder vertex along z, z in [-0.5, 0.5]
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec3 aStart;    // Per-instance bond start point
+layout(location = 3) in vec3 aEnd;      // Per-instance bond end point
+
+uniform mat4 model;
+
+#include "frame_data.glsl"
+
+void main()
+{
+    // Orthonormal frame with z along the bond
+    vec3 axis = aEnd - aStart;
+    float bondLength = length(axis);
+    vec3 w = bondLength > 0.0 ? axis / bondLength : vec3(0.0, 0.0, 1.0);
+    vec3 helper = abs(w.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    vec3 u = normalize(cross(helper, w));
+    mat3 basis = mat3(u, cross(w, u), w);
+
+    // Stretch the unit cylinder to the bond and expand along the normal direction
+    vec3 local = vec3(aPos.xy * bondRadius + aNormal.xy * outlineSize, aPos.z * bondLength);
+    vec3 pos = 0.5 * (aStart + aEnd) + basis * local;
+    gl_Position = projection * view * model * vec4(pos, 1.0);
+}
@@ -0,0 +1,30 @@
+#version 330 core
+
+in vec3 FragPos;            // Position on the impostor quad
+flat in vec3 Start;         // Start point of the bond
+flat in vec3 End;           // End point of the bond
+flat in float Radius;       // Radius of the bond
+
+layout(location = 0) out vec4 FragColor;
+layout(location = 1) out float LayerAlpha;
+
+uniform float alpha;                    // Transparency of the outline
+
+#include "frame_data.glsl"
+#include "impostor.glsl"
+#include "transparency.glsl"
+
+void main()
+{
+    // Keep the far side of the expanded tube, like the back faces of the inverted hull
+    vec3 rayDir = cameraFront(view);
+    float t;
+    if (!rayCylinder(FragPos, rayDir, Start, End, Radius + outlineSize, true, t)) {
+        discard;
+    }
+    float depth = fragDepth(FragPos + rayDir * t, view, projection);
+    gl_FragDepth = depth;
+
+    // Black outline with transparency
+    writeLayerColor(vec3(0.0), alpha, depth, FragColor, LayerAlpha);
+}
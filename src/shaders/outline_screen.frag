@@ -0,0 +1,44 @@
+#version 330 core
+
+in vec2 TexCoord;
+
+out vec4 FragColor;
+
+uniform sampler2D sceneColor;   // Shaded scene
+uniform sampler2D sceneAlpha;   // Alpha of the front-most layer
+uniform sampler2D sceneDepth;   // Depth of the front-most surface
+
+#include "frame_data.glsl"
+
+const int DIRECTIONS = 16;
+const int RINGS = 3;
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(sceneDepth, 0));
+
+    // Outline size is given in world units, the projection is orthographic
+    float radius = outlineSize * projection[0][0] * 0.5 / texel.x;
+    // Depth buffer step to world distance
+    float depthScale = 2.0 / abs(projection[2][2]);
+
+    float depth = texture(sceneDepth, TexCoord).r;
+
+    // Darken pixels that have a clearly nearer surface within the outline size,
+    // which puts the outline just outside the silhouette like the inverted hull
+    float outline = 0.0;
+    for (int ring = 1; ring <= RINGS; ring++) {
+        float distance = radius * float(ring) / float(RINGS);
+        for (int i = 0; i < DIRECTIONS; i++) {
+            float angle = 6.2831853 * float(i) / float(DIRECTIONS);
+            vec2 uv = TexCoord + vec2(cos(angle), sin(angle)) * distance * texel;
+            float neighborDepth = texture(sceneDepth, uv).r;
+            if ((depth - neighborDepth) * depthScale > outlineDepthThreshold) {
+                outline = max(outline, texture(sceneAlpha, uv).r);
+            }
+        }
+    }
+
+    vec3 color = texture(sceneColor, TexCoord).rgb;
+    FragColor = vec4(mix(color, vec3(0.0), outline), 1.0);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+
+out vec2 TexCoord;
+
+void main()
+{
+    // One triangle covering the screen, built from the vertex index
+    vec2 pos = vec2((gl_VertexID == 1) ? 3.0 : -1.0, (gl_VertexID == 2) ? 3.0 : -1.0);
+    TexCoord = pos * 0.5 + 0.5;
+    gl_Position = vec4(pos, 0.0, 1.0);
+}
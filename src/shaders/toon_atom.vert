@@ -0,0 +1,30 @@
+#version 330 core
+
+layout(location = 0) in vec3 aPos;      // Unit sphere vertex
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in float aCenterX;  // Per-instance atom position, one array per axis
+layout(location = 5) in float aCenterY;
+layout(location = 6) in float aCenterZ;
+layout(location = 3) in float aRadius;  // Per-instance atom radius
+layout(location = 4) in vec3 aColor;    // Per-instance atom color
+
+out vec3 Normal;
+out vec3 FragPos;
+out vec3 ObjectColor;
+
+uniform mat4 model;
+uniform vec3 objectColor;       // Color of the layer
+uniform bool overwriteColor;    // True to use objectColor instead of the atom color
+
+#include "frame_data.glsl"
+
+void main()
+{
+    vec3 center = vec3(aCenterX, aCenterY, aCenterZ);
+
+    FragPos = vec3(model * vec4(center + aPos * aRadius, 1.0));
+    Normal = mat3(transpose(inverse(model))) * aNormal;
+    ObjectColor = overwriteColor ? objectColor : aColor;
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
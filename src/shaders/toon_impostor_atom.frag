@@ -0,0 +1,31 @@
+#version 330 core
+
+in vec3 FragPos;            // Position on the impostor quad
+flat in vec3 Center;        // Center of the sphere
+flat in float Radius;       // Radius of the sphere
+flat in vec3 ObjectColor;   // Color of the object
+
+layout(location = 0) out vec4 FragColor;
+layout(location = 1) out float LayerAlpha;   // Read by the screen-space outline pass
+
+uniform float alpha;                    // Transparency of the object
+
+#include "frame_data.glsl"
+#include "toon_lighting.glsl"
+#include "impostor.glsl"
+#include "transparency.glsl"
+
+void main()
+{
+    vec3 rayDir = cameraFront(view);
+    float t;
+    if (!raySphere(FragPos, rayDir, Center, Radius, false, t)) {
+        discard;
+    }
+    vec3 hitPos = FragPos + rayDir * t;
+    float depth = fragDepth(hitPos, view, projection);
+    gl_FragDepth = depth;
+
+    vec3 norm = (hitPos - Center) / Radius;
+    writeLayerColor(toonShading(norm, hitPos, ObjectColor), alpha, depth, FragColor, LayerAlpha);
+}
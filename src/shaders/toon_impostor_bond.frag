@@ -0,0 +1,34 @@
+#version 330 core
+
+in vec3 FragPos;            // Position on the impostor quad
+flat in vec3 Start;         // Start point of the bond
+flat in vec3 End;           // End point of the bond
+flat in float Radius;       // Radius of the bond
+flat in vec3 ObjectColor;   // Color of the object
+
+layout(location = 0) out vec4 FragColor;
+layout(location = 1) out float LayerAlpha;   // Read by the screen-space outline pass
+
+uniform float alpha;                    // Transparency of the object
+
+#include "frame_data.glsl"
+#include "toon_lighting.glsl"
+#include "impostor.glsl"
+#include "transparency.glsl"
+
+void main()
+{
+    vec3 rayDir = cameraFront(view);
+    float t;
+    if (!rayCylinder(FragPos, rayDir, Start, End, Radius, false, t)) {
+        discard;
+    }
+    vec3 hitPos = FragPos + rayDir * t;
+    float depth = fragDepth(hitPos, view, projection);
+    gl_FragDepth = depth;
+
+    // Normal is the hit point minus its projection on the bond axis
+    vec3 axis = normalize(End - Start);
+    vec3 norm = normalize((hitPos - Start) - dot(hitPos - Start, axis) * axis);
+    writeLayerColor(toonShading(norm, hitPos, ObjectColor), alpha, depth, FragColor, LayerAlpha);
+}
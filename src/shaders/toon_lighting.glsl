@@ -0,0 +1,47 @@
+// Toon lighting shared by toon.frag and the impostor shaders.
+// Included after #version by loadShader.
+
+#include "frame_data.glsl"
+
+vec3 toonShading(vec3 norm, vec3 fragPos, vec3 objectColor)
+{
+    vec3 lightDir;
+    
+    // Light vectors, see also:
+    // https://zhuanlan.zhihu.com/p/427477685
+    if (isDirectionalLight) {
+        lightDir = normalize(-lightPos);            // Parallel light
+    } else {
+        lightDir = normalize(lightPos - fragPos);   // Point light
+    }
+    // Diff. coeff.(DC)
+    // In most case, the final coefficient should be
+    // DC * mater. DC * light. DC
+    // In this model, only the basic part is used.
+    float diffIntensity = max(dot(norm, lightDir), 0.0);
+    
+    // Calculate color
+    vec3 result;
+    if (diffIntensity > shadowThreshold) {
+        // Highlight effects. Use specular light model
+        float shininess = 32.0;
+        float highlightColor = 0.3;
+
+        vec3 viewDir = normalize(viewPos - fragPos);
+        // genType reflect(	genType I, genType N);
+        // I: Specifies the incident vector.
+        // N: Specifies the normal vector.
+        vec3 reflectDir = reflect(-lightDir, norm);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+        // > hightlightThreshold: highlightColor
+        // <= hightlightThreshold: no additional highlight
+        float toonSpec = (spec > highlightThreshold) ? highlightColor : 0.0;
+
+        // Add highlight color to object color
+        result = objectColor + vec3(toonSpec);
+    } else {
+        // Given shadow color, irrelevant to object color
+        result = shadowColor;
+    }
+    return result;
+}
@@ -0,0 +1,22 @@
+// Weighted blended order-independent transparency, see McGuire and Bavoil,
+// "Weighted Blended Order-Independent Transparency", JCGT 2(2), 2013.
+// Included after #version by loadShader.
+
+uniform bool transparentPass;   // Drawing a translucent layer into the accumulation target
+
+// Write the color of a fragment. In the transparent pass the first output sums the
+// weighted, premultiplied color (its alpha keeps the product of 1 - alpha), the
+// second sums the weights; otherwise they are the color and the layer alpha.
+// depth: Window-space depth of the fragment, 0 at the near plane.
+void writeLayerColor(vec3 color, float alpha, float depth, out vec4 fragColor, out float layerAlpha)
+{
+    if (transparentPass) {
+        // Nearer surfaces weigh more, so the front layers dominate where many overlap
+        float weight = alpha * clamp(3e3 * pow(1.0 - depth, 3.0), 1e-2, 3e3);
+        fragColor = vec4(color * alpha * weight, alpha);
+        layerAlpha = alpha * weight;
+    } else {
+        fragColor = vec4(color, alpha);
+        layerAlpha = alpha;
+    }
+}
@@ -0,0 +1,19 @@
+#version 330 core
+
+in vec2 TexCoord;
+
+out vec4 FragColor;
+
+uniform sampler2D accumulation;     // Weighted premultiplied color, alpha is the revealage
+uniform sampler2D weights;          // Sum of the weights
+
+void main()
+{
+    vec4 accum = texture(accumulation, TexCoord);
+    float revealage = accum.a;
+    if (revealage >= 1.0) {
+        discard;    // No translucent surface here
+    }
+    float weight = texture(weights, TexCoord).r;
+    FragColor = vec4(accum.rgb / max(weight, 1e-5), 1.0 - revealage);
+}
@@ -0,0 +1,179 @@
+/*
+PNG band splitting of ImageStreamWriter: encode images with many encoder
+threads, decode them back with zlib and compare every pixel.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "Exporter.hpp"
+
+/*
+Read a whole file.
+*/
+static bool readFile(const std::string& filename, std::vector<unsigned char>& data)
+{
+    FILE* file = std::fopen(filename.c_str(), "rb");
+    if (file == NULL) {
+        return false;
+    }
+    unsigned char buffer[65536];
+    size_t length;
+    while ((length = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + length);
+    }
+    std::fclose(file);
+    return true;
+}
+
+static unsigned int readBigEndian(const unsigned char* p)
+{
+    return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+}
+
+/*
+Decode an 8 bit RGB PNG without interlacing.
+@return: false if the chunks, the zlib stream or a filter type are invalid.
+*/
+static bool decodePNG(const std::vector<unsigned char>& png, int& width, int& height, std::vector<unsigned char>& rgb)
+{
+    static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    if (png.size() < 8 || std::memcmp(png.data(), signature, 8) != 0) {
+        return false;
+    }
+    std::vector<unsigned char> idat;
+    size_t offset = 8;
+    bool ended = false;
+    while (!ended && offset + 12 <= png.size()) {
+        const size_t length = readBigEndian(&png[offset]);
+        const unsigned char* type = &png[offset + 4];
+        const unsigned char* data = &png[offset + 8];
+        if (offset + 12 + length > png.size()) {
+            return false;
+        }
+        const uLong crc = crc32(crc32(0L, type, 4), data, (uInt)length);
+        if (crc != readBigEndian(data + length)) {
+            return false;
+        }
+        if (std::memcmp(type, "IHDR", 4) == 0) {
+            width = (int)readBigEndian(data);
+            height = (int)readBigEndian(data + 4);
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            idat.insert(idat.end(), data, data + length);
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            ended = true;
+        }
+        offset += 12 + length;
+    }
+    if (!ended) {
+        return false;
+    }
+
+    // inflate checks the Adler-32 of the rows at the end of the stream
+    const size_t rowLength = (size_t)width * 3;
+    std::vector<unsigned char> filtered((rowLength + 1) * height + 1);
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (inflateInit(&stream) != Z_OK) {
+        return false;
+    }
+    stream.next_in = idat.data();
+    stream.avail_in = (uInt)idat.size();
+    stream.next_out = filtered.data();
+    stream.avail_out = (uInt)filtered.size();
+    const int status = inflate(&stream, Z_FINISH);
+    const size_t inflated = stream.total_out;
+    inflateEnd(&stream);
+    if (status != Z_STREAM_END || inflated != (rowLength + 1) * height) {
+        return false;
+    }
+
+    rgb.assign(rowLength * height, 0);
+    const std::vector<unsigned char> zeros(rowLength, 0);
+    for (int r = 0; r < height; r++) {
+        const int filter = filtered[r * (rowLength + 1)];
+        const unsigned char* in = &filtered[r * (rowLength + 1) + 1];
+        unsigned char* out = &rgb[r * rowLength];
+        const unsigned char* above = r == 0 ? zeros.data() : out - rowLength;
+        for (size_t i = 0; i < rowLength; i++) {
+            const int a = i >= 3 ? out[i - 3] : 0;
+            const int b = above[i];
+            const int c = i >= 3 ? above[i - 3] : 0;
+            int predictor = 0;
+            if (filter == 1) {
+                predictor = a;
+            } else if (filter == 2) {
+                predictor = b;
+            } else if (filter == 3) {
+                predictor = (a + b) / 2;
+            } else if (filter == 4) {
+                const int p = a + b - c;
+                const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+                predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+            } else if (filter != 0) {
+                return false;
+            }
+            out[i] = (unsigned char)(in[i] + predictor);
+        }
+    }
+    return true;
+}
+
+/*
+Encode a test pattern with the given number of encoder threads, written in
+slices of sliceRows rows, and check that it decodes to the same pixels.
+*/
+static bool roundTrip(int width, int height, int threadCount, int sliceRows)
+{
+    std::vector<unsigned char> source((size_t)width * height * 3);
+    unsigned int seed = 12345;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            unsigned char* pixel = &source[((size_t)y * width + x) * 3];
+            seed = seed * 1103515245 + 12345;
+            // Smooth gradients with some noise, so every filter type gets picked
+            pixel[0] = (unsigned char)(x + y);
+            pixel[1] = (unsigned char)(x * y / 7);
+            pixel[2] = (unsigned char)((seed >> 16) & (x % 5 == 0 ? 0xff : 0x03));
+        }
+    }
+
+    const std::string filename = "png_bands_test_" + std::to_string(height) + "_" + std::to_string(threadCount) + ".png";
+    exporter::ImageStreamWriter writer;
+    bool ok = writer.open(filename, IMAGE_FORMAT_PNG, width, height, 6, threadCount);
+    for (int y = 0; ok && y < height; y += sliceRows) {
+        ok = writer.writeRows(&source[(size_t)y * width * 3], std::min(sliceRows, height - y));
+    }
+    ok = writer.close() && ok;
+
+    std::vector<unsigned char> png;
+    std::vector<unsigned char> decoded;
+    int decodedWidth = 0;
+    int decodedHeight = 0;
+    ok = ok && readFile(filename, png)
+        && decodePNG(png, decodedWidth, decodedHeight, decoded)
+        && decodedWidth == width && decodedHeight == height
+        && decoded == source;
+    std::remove(filename.c_str());
+
+    std::cout << (ok ? "ok     " : "FAILED ") << width << "x" << height
+        << " threads " << threadCount << " slices of " << sliceRows << " rows" << std::endl;
+    return ok;
+}
+
+int main()
+{
+    bool ok = true;
+    // 1121 rows on 64 threads left the last band with -1 rows, 1089 with empty bands
+    ok = roundTrip(97, 1121, 64, 1121) && ok;
+    ok = roundTrip(97, 1089, 64, 1089) && ok;
+    ok = roundTrip(97, 1121, 35, 1121) && ok;
+    ok = roundTrip(97, 1121, 64, 500) && ok;
+    ok = roundTrip(33, 31, 64, 31) && ok;
+    ok = roundTrip(33, 65, 3, 65) && ok;
+    ok = roundTrip(1, 1, 64, 1) && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}